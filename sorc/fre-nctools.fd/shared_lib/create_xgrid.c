@@ -4,6 +4,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 #include "mosaic_util.h"
 #include "create_xgrid.h"
 #include "constant.h"
@@ -852,6 +855,255 @@ nxgrid = 0;
   
 };/* get_xgrid_2Dx2D_order1 */
 
+/* exchange grid cells found by one thread for the current block of output rows */
+typedef struct {
+  int    nxgrid;
+  int    size;
+  int    *i_in, *j_in, *i_out, *j_out;
+  double *area;
+} Xgrid_buffer;
+
+static void xgrid_buffer_add(Xgrid_buffer *buf, int i1, int j1, int i2, int j2, double xarea)
+{
+  if(buf->nxgrid == buf->size) {
+    buf->size  = buf->size ? 2*buf->size : 1024;
+    buf->i_in  = (int *)realloc(buf->i_in,  buf->size*sizeof(int));
+    buf->j_in  = (int *)realloc(buf->j_in,  buf->size*sizeof(int));
+    buf->i_out = (int *)realloc(buf->i_out, buf->size*sizeof(int));
+    buf->j_out = (int *)realloc(buf->j_out, buf->size*sizeof(int));
+    buf->area  = (double *)realloc(buf->area, buf->size*sizeof(double));
+    if(!buf->i_in || !buf->j_in || !buf->i_out || !buf->j_out || !buf->area)
+      error_handler("create_xgrid.c: not enough memory for the exchange grid of one row block");
+  }
+  buf->i_in[buf->nxgrid]  = i1;
+  buf->j_in[buf->nxgrid]  = j1;
+  buf->i_out[buf->nxgrid] = i2;
+  buf->j_out[buf->nxgrid] = j2;
+  buf->area[buf->nxgrid]  = xarea;
+  buf->nxgrid++;
+}
+
+/**
+  long create_xgrid_2dx2d_order1_stream
+  Same exchange grid as create_xgrid_2dx2d_order1, but the output grid is processed
+  in blocks of nrow_block rows (all rows when nrow_block < 1). The exchange grid
+  cells of each block are passed to sink, with sink_data, and are not kept, so the
+  memory used is set by the block size instead of the whole output tile and
+  MAXXGRID. Input rows outside the latitude range of a block are skipped.
+  Returns the total number of exchange grid cells.
+*/
+long create_xgrid_2dx2d_order1_stream(const int *nlon_in, const int *nlat_in, const int *nlon_out, const int *nlat_out,
+				      const double *lon_in, const double *lat_in, const double *lon_out, const double *lat_out,
+				      const double *mask_in, int nrow_block, xgrid_sink sink, void *sink_data)
+{
+  int nx1, nx2, ny1, ny2, nx1p, nx2p, j1, j2start, nrow, npts;
+  int nblocks, m, npts_left, nblks_left, pos, npts_my, ij;
+  int *istart2=NULL, *iend2=NULL;
+  double *area_in, *area_out, *row_lat_min, *row_lat_max;
+  double *lon_out_min_list,*lon_out_max_list,*lon_out_avg,*lat_out_min_list,*lat_out_max_list;
+  double *lon_out_list, *lat_out_list;
+  int    *n2_list;
+  Xgrid_buffer *buf;
+  long nxgrid;
+
+  nx1 = *nlon_in;
+  ny1 = *nlat_in;
+  nx2 = *nlon_out;
+  ny2 = *nlat_out;
+  nx1p = nx1 + 1;
+  nx2p = nx2 + 1;
+  if(nrow_block < 1 || nrow_block > ny2) nrow_block = ny2;
+
+  area_in  = (double *)malloc(nx1*ny1*sizeof(double));
+  get_grid_area(nlon_in, nlat_in, lon_in, lat_in, area_in);
+
+  /* latitude range of each input row, to skip the rows away from a block */
+  row_lat_min = (double *)malloc(ny1*sizeof(double));
+  row_lat_max = (double *)malloc(ny1*sizeof(double));
+  for(j1=0; j1<ny1; j1++) {
+    row_lat_min[j1] = minval_double(2*nx1p, lat_in+j1*nx1p);
+    row_lat_max[j1] = maxval_double(2*nx1p, lat_in+j1*nx1p);
+  }
+
+  nblocks = 1;
+#if defined(_OPENMP)
+#pragma omp parallel
+  nblocks = omp_get_num_threads();
+#endif
+
+  istart2 = (int *)malloc(nblocks*sizeof(int));
+  iend2   = (int *)malloc(nblocks*sizeof(int));
+  buf     = (Xgrid_buffer *)calloc(nblocks, sizeof(Xgrid_buffer));
+
+  npts = nx2*nrow_block;
+  area_out         = (double *)malloc(npts*sizeof(double));
+  lon_out_min_list = (double *)malloc(npts*sizeof(double));
+  lon_out_max_list = (double *)malloc(npts*sizeof(double));
+  lat_out_min_list = (double *)malloc(npts*sizeof(double));
+  lat_out_max_list = (double *)malloc(npts*sizeof(double));
+  lon_out_avg      = (double *)malloc(npts*sizeof(double));
+  n2_list          = (int *)malloc(npts*sizeof(int));
+  lon_out_list     = (double *)malloc(MAX_V*npts*sizeof(double));
+  lat_out_list     = (double *)malloc(MAX_V*npts*sizeof(double));
+
+  nxgrid = 0;
+  for(j2start=0; j2start<ny2; j2start+=nrow_block) {
+    double lat_blk_min, lat_blk_max;
+
+    nrow = min(nrow_block, ny2-j2start);
+    npts = nx2*nrow;
+    get_grid_area(nlon_out, &nrow, lon_out+j2start*nx2p, lat_out+j2start*nx2p, area_out);
+
+#if defined(_OPENMP)
+#pragma omp parallel for default(none) shared(nx2,npts,nx2p,j2start,lon_out,lat_out,lat_out_min_list, \
+                                              lat_out_max_list,lon_out_min_list,lon_out_max_list, \
+                                              lon_out_avg,n2_list,lon_out_list,lat_out_list)
+#endif
+    for(ij=0; ij<npts; ij++){
+      int i2, j2, n0, n1, n2, n3, n2_in, l;
+      double x2_in[MV], y2_in[MV];
+      i2 = ij%nx2;
+      j2 = j2start + ij/nx2;
+      n0 = j2*nx2p+i2; n1 = j2*nx2p+i2+1;
+      n2 = (j2+1)*nx2p+i2+1; n3 = (j2+1)*nx2p+i2;
+      x2_in[0] = lon_out[n0]; y2_in[0] = lat_out[n0];
+      x2_in[1] = lon_out[n1]; y2_in[1] = lat_out[n1];
+      x2_in[2] = lon_out[n2]; y2_in[2] = lat_out[n2];
+      x2_in[3] = lon_out[n3]; y2_in[3] = lat_out[n3];
+
+      lat_out_min_list[ij] = minval_double(4, y2_in);
+      lat_out_max_list[ij] = maxval_double(4, y2_in);
+      n2_in = fix_lon(x2_in, y2_in, 4, M_PI);
+      if(n2_in > MAX_V) error_handler("create_xgrid.c: n2_in is greater than MAX_V");
+      lon_out_min_list[ij] = minval_double(n2_in, x2_in);
+      lon_out_max_list[ij] = maxval_double(n2_in, x2_in);
+      lon_out_avg[ij] = avgval_double(n2_in, x2_in);
+      n2_list[ij] = n2_in;
+      for(l=0; l<n2_in; l++) {
+	lon_out_list[ij*MAX_V+l] = x2_in[l];
+	lat_out_list[ij*MAX_V+l] = y2_in[l];
+      }
+    }
+    lat_blk_min = minval_double(npts, lat_out_min_list);
+    lat_blk_max = maxval_double(npts, lat_out_max_list);
+
+    npts_left = npts;
+    nblks_left = nblocks;
+    pos = 0;
+    for(m=0; m<nblocks; m++) {
+      istart2[m] = pos;
+      npts_my = npts_left/nblks_left;
+      iend2[m] = istart2[m] + npts_my - 1;
+      pos = iend2[m] + 1;
+      npts_left -= npts_my;
+      nblks_left--;
+    }
+
+#if defined(_OPENMP)
+#pragma omp parallel for default(none) shared(nblocks,nx1,ny1,nx1p,mask_in,lon_in,lat_in,row_lat_min,row_lat_max, \
+                                              lat_blk_min,lat_blk_max,istart2,iend2,nx2,j2start,lat_out_min_list, \
+                                              lat_out_max_list,n2_list,lon_out_list,lat_out_list,lon_out_min_list, \
+                                              lon_out_max_list,lon_out_avg,area_in,area_out,buf)
+#endif
+    for(m=0; m<nblocks; m++) {
+      int i1, j1, ij;
+      buf[m].nxgrid = 0;
+      for(j1=0; j1<ny1; j1++) {
+	if(row_lat_min[j1] >= lat_blk_max || row_lat_max[j1] <= lat_blk_min) continue;
+	for(i1=0; i1<nx1; i1++) if( mask_in[j1*nx1+i1] > MASK_THRESH ) {
+	  int n0, n1, n2, n3, l,n1_in;
+	  double lat_in_min,lat_in_max,lon_in_min,lon_in_max,lon_in_avg;
+	  double x1_in[MV], y1_in[MV], x_out[MV], y_out[MV];
+
+	  n0 = j1*nx1p+i1;       n1 = j1*nx1p+i1+1;
+	  n2 = (j1+1)*nx1p+i1+1; n3 = (j1+1)*nx1p+i1;
+	  x1_in[0] = lon_in[n0]; y1_in[0] = lat_in[n0];
+	  x1_in[1] = lon_in[n1]; y1_in[1] = lat_in[n1];
+	  x1_in[2] = lon_in[n2]; y1_in[2] = lat_in[n2];
+	  x1_in[3] = lon_in[n3]; y1_in[3] = lat_in[n3];
+	  lat_in_min = minval_double(4, y1_in);
+	  lat_in_max = maxval_double(4, y1_in);
+	  n1_in = fix_lon(x1_in, y1_in, 4, M_PI);
+	  lon_in_min = minval_double(n1_in, x1_in);
+	  lon_in_max = maxval_double(n1_in, x1_in);
+	  lon_in_avg = avgval_double(n1_in, x1_in);
+	  for(ij=istart2[m]; ij<=iend2[m]; ij++) {
+	    int n_out, i2, j2, n2_in;
+	    double xarea, dx, lon_out_min, lon_out_max;
+	    double x2_in[MAX_V], y2_in[MAX_V];
+
+	    i2 = ij%nx2;
+	    j2 = j2start + ij/nx2;
+
+	    if(lat_out_min_list[ij] >= lat_in_max || lat_out_max_list[ij] <= lat_in_min ) continue;
+	    /* adjust x2_in according to lon_in_avg*/
+	    n2_in = n2_list[ij];
+	    for(l=0; l<n2_in; l++) {
+	      x2_in[l] = lon_out_list[ij*MAX_V+l];
+	      y2_in[l] = lat_out_list[ij*MAX_V+l];
+	    }
+	    lon_out_min = lon_out_min_list[ij];
+	    lon_out_max = lon_out_max_list[ij];
+	    dx = lon_out_avg[ij] - lon_in_avg;
+	    if(dx < -M_PI ) {
+	      lon_out_min += TPI;
+	      lon_out_max += TPI;
+	      for (l=0; l<n2_in; l++) x2_in[l] += TPI;
+	    }
+	    else if (dx >  M_PI) {
+	      lon_out_min -= TPI;
+	      lon_out_max -= TPI;
+	      for (l=0; l<n2_in; l++) x2_in[l] -= TPI;
+	    }
+
+	    if(lon_out_min >= lon_in_max || lon_out_max <= lon_in_min ) continue;
+	    if (  (n_out = clip_2dx2d( x1_in, y1_in, n1_in, x2_in, y2_in, n2_in, x_out, y_out )) > 0) {
+	      double min_area;
+	      xarea = poly_area (x_out, y_out, n_out ) * mask_in[j1*nx1+i1];
+	      min_area = min(area_in[j1*nx1+i1], area_out[ij]);
+	      if( xarea/min_area > AREA_RATIO_THRESH )
+		xgrid_buffer_add(buf+m, i1, j1, i2, j2, xarea);
+	    }
+	  }
+	}
+      }
+    }
+
+    /* hand the block to the sink in the order of the threads */
+    for(m=0; m<nblocks; m++) {
+      if(buf[m].nxgrid == 0) continue;
+      sink(buf[m].nxgrid, buf[m].i_in, buf[m].j_in, buf[m].i_out, buf[m].j_out, buf[m].area, sink_data);
+      nxgrid += buf[m].nxgrid;
+    }
+  }
+
+  for(m=0; m<nblocks; m++) {
+    free(buf[m].i_in);
+    free(buf[m].j_in);
+    free(buf[m].i_out);
+    free(buf[m].j_out);
+    free(buf[m].area);
+  }
+  free(buf);
+  free(istart2);
+  free(iend2);
+  free(area_in);
+  free(area_out);
+  free(row_lat_min);
+  free(row_lat_max);
+  free(lon_out_min_list);
+  free(lon_out_max_list);
+  free(lat_out_min_list);
+  free(lat_out_max_list);
+  free(lon_out_avg);
+  free(n2_list);
+  free(lon_out_list);
+  free(lat_out_list);
+
+  return nxgrid;
+
+};/* create_xgrid_2dx2d_order1_stream */
+
 /**
   void create_xgrid_2dx1d_order2
   This routine generate exchange grids between two grids for the second order
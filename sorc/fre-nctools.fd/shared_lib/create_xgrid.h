@@ -10,6 +10,11 @@
 #define MV 50
 /* this value is small compare to earth area */
 
+/* receives the exchange grid cells of one row block from create_xgrid_2dx2d_order1_stream,
+   the arrays are only valid during the call */
+typedef void (*xgrid_sink)(int nxgrid, const int *i_in, const int *j_in, const int *i_out, const int *j_out,
+			   const double *xgrid_area, void *sink_data);
+
 double poly_ctrlon(const double lon[], const double lat[], int n, double clon);
 double poly_ctrlat(const double lon[], const double lat[], int n);
 double box_ctrlon(double ll_lon, double ll_lat, double ur_lon, double ur_lat, double clon);
@@ -44,6 +49,9 @@ int create_xgrid_2dx2d_order1(const int *nlon_in, const int *nlat_in, const int
 			      const double *lon_in, const double *lat_in, const double *lon_out, const double *lat_out,
 			      const double *mask_in, int *i_in, int *j_in, int *i_out,
 			      int *j_out, double *xgrid_area);
+long create_xgrid_2dx2d_order1_stream(const int *nlon_in, const int *nlat_in, const int *nlon_out, const int *nlat_out,
+				      const double *lon_in, const double *lat_in, const double *lon_out, const double *lat_out,
+				      const double *mask_in, int nrow_block, xgrid_sink sink, void *sink_data);
 int create_xgrid_2dx2d_order2(const int *nlon_in, const int *nlat_in, const int *nlon_out, const int *nlat_out,
 			      const double *lon_in, const double *lat_in, const double *lon_out, const double *lat_out,
 			      const double *mask_in, int *i_in, int *j_in, int *i_out, int *j_out,
@@ -101,6 +101,123 @@ void grad_c2l(const int *nlon, const int *nlat, const double *pin, const double
   
 }; /* grad_c2l */
 
+/*------------------------------------------------------------------------------
+  grad_c2l_weight computes the geometric weights used by grad_c2l_nz.
+  The gradient computed by grad_c2l is a linear combination of the four
+  B-grid (cell corner) values of the cell, with coefficients that only
+  depend on the grid. Precompute them once so that the gradient of any
+  number of fields and levels is a short stencil over the corner values.
+  dx, dy, area, en_n, en_e, vlon and vlat are as in grad_c2l.
+  The size of wgt will be (nx, ny, 8): wgt[m*nx*ny+j*nx+i] holds the
+  weight of the SW(m=0), SE(1), NW(2) and NE(3) corner for grad_x and
+  of the same corners for grad_y (m=4..7).
+  ----------------------------------------------------------------------------*/
+void grad_c2l_weight(int nx, int ny, const double *dx, const double *dy, const double *area,
+		     const double *en_n, const double *en_e, const double *vlon, const double *vlat,
+		     double *wgt)
+{
+  int nxp, nxy, i, j;
+
+  nxp = nx+1;
+  nxy = nx*ny;
+#if defined(_OPENMP)
+#pragma omp parallel for default(none) shared(nx,ny,nxp,nxy,dx,dy,area,en_n,en_e,vlon,vlat,wgt) private(i)
+#endif
+  for(j=0; j<ny; j++) for(i=0; i<nx; i++) {
+    int m0, ms, mn, mw, me, n;
+    double as[2], an[2], bw[2], be[2], fac;
+    const double *v;
+
+    m0 = j*nx+i;
+    ms = j*nx+i;         /* south face, N-cell index */
+    mn = (j+1)*nx+i;     /* north face, N-cell index */
+    mw = j*nxp+i;        /* west face,  E-cell index */
+    me = j*nxp+i+1;      /* east face,  E-cell index */
+    /* project the face normals onto the local lon (n=0) and lat (n=1) directions */
+    for(n=0; n<2; n++) {
+      v = n==0 ? vlon+3*m0 : vlat+3*m0;
+      as[n] = dx[ms]*(v[0]*en_n[3*ms]+v[1]*en_n[3*ms+1]+v[2]*en_n[3*ms+2]);
+      an[n] = dx[mn]*(v[0]*en_n[3*mn]+v[1]*en_n[3*mn+1]+v[2]*en_n[3*mn+2]);
+      bw[n] = dy[mw]*(v[0]*en_e[3*mw]+v[1]*en_e[3*mw+1]+v[2]*en_e[3*mw+2]);
+      be[n] = dy[me]*(v[0]*en_e[3*me]+v[1]*en_e[3*me+1]+v[2]*en_e[3*me+2]);
+    }
+    fac = 0.5*RADIUS/area[m0];
+    for(n=0; n<2; n++) {
+      wgt[(4*n  )*nxy+m0] = fac*(-as[n]-bw[n]);  /* SW */
+      wgt[(4*n+1)*nxy+m0] = fac*(-as[n]+be[n]);  /* SE */
+      wgt[(4*n+2)*nxy+m0] = fac*( an[n]-bw[n]);  /* NW */
+      wgt[(4*n+3)*nxy+m0] = fac*( an[n]+be[n]);  /* NE */
+    }
+  }
+
+}; /* grad_c2l_weight */
+
+/*------------------------------------------------------------------------------
+  grad_c2l_nz computes the same gradient as grad_c2l for nz levels at once
+  using the weights from grad_c2l_weight.
+  The size of pin    will be (nx+2, ny+2, nz), T-cell center, with halo = 1
+  The size of grad_x will be (nx, ny, nz)
+  The size of grad_y will be (nx, ny, nz)
+  Rows are distributed over OpenMP threads. For each row the weights are
+  reused for all the levels and the innermost loop is contiguous in i.
+  ----------------------------------------------------------------------------*/
+void grad_c2l_nz(int nx, int ny, int nz, const double *pin, const double *wgt,
+		 const double *edge_w, const double *edge_e, const double *edge_s, const double *edge_n,
+		 double *grad_x, double *grad_y, int on_west_edge, int on_east_edge,
+		 int on_south_edge, int on_north_edge)
+{
+  double *pb;
+  int nxp, nyp, nxy, k, j;
+
+  nxp = nx+1;
+  nyp = ny+1;
+  nxy = nx*ny;
+  pb  = (double *)malloc(nxp*nyp*nz*sizeof(double));
+
+#if defined(_OPENMP)
+#pragma omp parallel for default(none) shared(nx,ny,nz,nxp,nyp,pin,pb,edge_w,edge_e,edge_s,edge_n, \
+                                              on_west_edge,on_east_edge,on_south_edge,on_north_edge)
+#endif
+  for(k=0; k<nz; k++)
+    a2b_ord2(nx, ny, pin+k*(nx+2)*(ny+2), edge_w, edge_e, edge_s, edge_n, pb+k*nxp*nyp,
+	     on_west_edge, on_east_edge, on_south_edge, on_north_edge);
+
+#if defined(_OPENMP)
+#pragma omp parallel for default(none) shared(nx,ny,nz,nxp,nyp,nxy,pb,wgt,grad_x,grad_y) private(k)
+#endif
+  for(j=0; j<ny; j++) {
+    const double *wx0, *wx1, *wx2, *wx3, *wy0, *wy1, *wy2, *wy3;
+    const double *ps, *pn;
+    double *gx, *gy;
+    int i;
+
+    wx0 = wgt +       j*nx;
+    wx1 = wgt +   nxy+j*nx;
+    wx2 = wgt + 2*nxy+j*nx;
+    wx3 = wgt + 3*nxy+j*nx;
+    wy0 = wgt + 4*nxy+j*nx;
+    wy1 = wgt + 5*nxy+j*nx;
+    wy2 = wgt + 6*nxy+j*nx;
+    wy3 = wgt + 7*nxy+j*nx;
+    for(k=0; k<nz; k++) {
+      ps = pb + k*nxp*nyp + j*nxp;
+      pn = ps + nxp;
+      gx = grad_x + k*nxy + j*nx;
+      gy = grad_y + k*nxy + j*nx;
+#if defined(_OPENMP) && _OPENMP >= 201307
+#pragma omp simd
+#endif
+      for(i=0; i<nx; i++) {
+	gx[i] = wx0[i]*ps[i] + wx1[i]*ps[i+1] + wx2[i]*pn[i] + wx3[i]*pn[i+1];
+	gy[i] = wy0[i]*ps[i] + wy1[i]*ps[i+1] + wy2[i]*pn[i] + wy3[i]*pn[i+1];
+      }
+    }
+  }
+
+  free(pb);
+
+}; /* grad_c2l_nz */
+
 /*------------------------------------------------------------------------------
   qin:  A-grid field, size (nx+2, ny+2)
   qout: B-grid field, size (nx+1, ny+1)
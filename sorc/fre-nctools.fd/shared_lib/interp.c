@@ -341,8 +341,10 @@ void conserve_interp_great_circle(int nx_src, int ny_src, int nx_dst, int ny_dst
 void linear_vertical_interp(int nx, int ny, int nk1, int nk2, const double *grid1, const double *grid2,
 			    double *data1, double *data2) 
 {
-  int n1, n2, i, n, k, l;
+  int n, k, l, nxy;
   double w;
+  const double *d1, *d2;
+  double *dd;
 
   for(k=1; k<nk1; k++) {
     if(grid1[k] <= grid1[k-1]) error_handler("interp.c: grid1 not monotonic");
@@ -354,22 +356,34 @@ void linear_vertical_interp(int nx, int ny, int nk1, int nk2, const double *grid
   if (grid1[0] > grid2[0] ) error_handler("interp.c: grid2 lies outside grid1");
   if (grid1[nk1-1] < grid2[nk2-1] ) error_handler("interp.c: grid2 lies outside grid1");
 
+  /* the levels of all the columns share grid1 and grid2, so each target
+     level is bracketed once and the column loops are contiguous */
+  nxy = nx*ny;
   for(k=0; k<nk2; k++) {    
-    n = nearest_index(grid2[k],grid1,nk1);
+    n  = nearest_index(grid2[k],grid1,nk1);
+    dd = data2 + k*nxy;
     if (grid1[n] < grid2[k]) {
-      w = (grid2[k]-grid1[n])/(grid1[n+1]-grid1[n]);
-      for(l=0; l<nx*ny; l++) {
-	data2[k*nx*ny+l] = (1.-w)*data1[n*nx*ny+l] + w*data1[(n+1)*nx*ny+l];
-      }
+      w  = (grid2[k]-grid1[n])/(grid1[n+1]-grid1[n]);
+      d1 = data1 + n*nxy;
+      d2 = data1 + (n+1)*nxy;
+#if defined(_OPENMP) && _OPENMP >= 201307
+#pragma omp simd
+#endif
+      for(l=0; l<nxy; l++) dd[l] = (1.-w)*d1[l] + w*d2[l];
     }
     else {
-      if(n==0)
-	for(l=0;l<nx*ny;l++) data2[k*nx*ny+l] = data1[n*nx*ny+l];
+      if(n==0) {
+	d1 = data1;
+	for(l=0; l<nxy; l++) dd[l] = d1[l];
+      }
       else {
-	w = (grid2[k]-grid1[n-1])/(grid1[n]-grid1[n-1]);
-	for(l=0; l<nx*ny; l++) {
-	  data2[k*nx*ny+l] = (1.-w)*data1[(n-1)*nx*ny+l] + w*data1[n*nx*ny+l];
-	}
+	w  = (grid2[k]-grid1[n-1])/(grid1[n]-grid1[n-1]);
+	d1 = data1 + (n-1)*nxy;
+	d2 = data1 + n*nxy;
+#if defined(_OPENMP) && _OPENMP >= 201307
+#pragma omp simd
+#endif
+	for(l=0; l<nxy; l++) dd[l] = (1.-w)*d1[l] + w*d2[l];
       }
     }
   }
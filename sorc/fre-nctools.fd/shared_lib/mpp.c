@@ -210,6 +210,24 @@ void mpp_sum_int(int count, int *data)
 
 }; /* mpp_sum_int */
 
+/*******************************************************************************
+  void mpp_sum_long(int count, long long *data)
+  sum 64-bit integer over all the pes.
+*******************************************************************************/
+void mpp_sum_long(int count, long long *data)
+{
+
+#ifdef use_libMPI
+  int i;
+  long long *sum;
+  sum = (long long *)malloc(count*sizeof(long long));
+  MPI_Allreduce(data, sum, count, MPI_LONG_LONG, MPI_SUM, comm);
+  for(i=0; i<count; i++)data[i] = sum[i];
+  free(sum);
+#endif
+
+}; /* mpp_sum_long */
+
 /*******************************************************************************
   void mpp_sum_double(int count, double *data)
   sum double over all the pes.
@@ -229,6 +247,19 @@ void mpp_sum_double(int count, double *data)
 
 }; /* mpp_sum_double */
 
+/*******************************************************************************
+  void mpp_broadcast_char(char *data, int size)
+  broadcast size characters from the root pe to all the pes.
+*******************************************************************************/
+void mpp_broadcast_char(char *data, int size)
+{
+
+#ifdef use_libMPI
+  MPI_Bcast(data, size, MPI_CHAR, root_pe, comm);
+#endif
+
+}; /* mpp_broadcast_char */
+
 void mpp_min_double(int count, double *data)
 {
 
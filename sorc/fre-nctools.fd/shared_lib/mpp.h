@@ -20,9 +20,11 @@ void mpp_recv_double(double* data, int size, int from_pe); /* recv data */
 void mpp_recv_int(int* data, int size, int from_pe); /* recv data */
 void mpp_error(char *str);
 void mpp_sum_int(int count, int *data);
+void mpp_sum_long(int count, long long *data);
 void mpp_sum_double(int count, double *data);
 void mpp_min_double(int count, double *data);
 void mpp_max_double(int count, double *data);
+void mpp_broadcast_char(char *data, int size); /* broadcast from the root pe */
 void print_mem_usage(const char* text);
 void print_time(const char* text, double t);
 void mpp_sync_self();
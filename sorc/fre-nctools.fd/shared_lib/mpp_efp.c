@@ -0,0 +1,145 @@
+/** @file
+    @brief Reproducible sums in extended fixed point, see mpp_efp.h.
+*/
+#include <math.h>
+#include <stdlib.h>
+#include "mpp.h"
+#include "mpp_efp.h"
+
+#define EFP_PREC      (1LL << EFP_NUMBIT)
+#define EFP_MAX_COUNT ((1 << (63-EFP_NUMBIT)) - 2)
+
+/* weight of each integer, and its inverse */
+static const double pr[EFP_NUMINT] = { 0x1p92, 0x1p46, 1.0, 0x1p-46, 0x1p-92, 0x1p-138 };
+static const double I_pr[EFP_NUMINT] = { 0x1p-92, 0x1p-46, 1.0, 0x1p46, 0x1p92, 0x1p138 };
+
+/*******************************************************************************
+  static void carry_efp(efp_type *efp)
+  move the overflow of each integer into the next more significant one, so
+  that all but the first one are less than EFP_PREC in magnitude.
+*******************************************************************************/
+static void carry_efp(efp_type *efp)
+{
+  int i;
+  long long num_carry;
+
+  for(i=EFP_NUMINT-1; i>0; i--) {
+    if(llabs(efp->v[i]) >= EFP_PREC) {
+      num_carry = efp->v[i] / EFP_PREC;
+      efp->v[i] -= num_carry*EFP_PREC;
+      efp->v[i-1] += num_carry;
+    }
+  }
+  if(llabs(efp->v[0]) >= EFP_PREC) mpp_error("mpp_efp(carry_efp): overflow of the reproducible sum");
+  efp->count = 1;
+
+}; /* carry_efp */
+
+/*******************************************************************************
+  void efp_clear(efp_type *efp)
+  set the sum to zero.
+*******************************************************************************/
+void efp_clear(efp_type *efp)
+{
+  int i;
+
+  for(i=0; i<EFP_NUMINT; i++) efp->v[i] = 0;
+  efp->count = 0;
+
+}; /* efp_clear */
+
+/*******************************************************************************
+  void efp_add(efp_type *efp, double x)
+  add x to the sum. x is truncated to a multiple of 2^-138, |x| must be
+  less than 2^138.
+*******************************************************************************/
+void efp_add(efp_type *efp, double x)
+{
+  int i;
+  long long ival;
+  double rs;
+
+  rs = fabs(x);
+  if(!(rs < pr[0]*EFP_PREC)) mpp_error("mpp_efp(efp_add): value out of the range of the reproducible sum");
+  if(efp->count >= EFP_MAX_COUNT) carry_efp(efp);
+  for(i=0; i<EFP_NUMINT; i++) {
+    ival = (long long)(rs*I_pr[i]);
+    rs -= ival*pr[i];
+    if(x >= 0)
+      efp->v[i] += ival;
+    else
+      efp->v[i] -= ival;
+  }
+  efp->count++;
+
+}; /* efp_add */
+
+/*******************************************************************************
+  void efp_merge(efp_type *efp, const efp_type *other)
+  add the sum other to efp.
+*******************************************************************************/
+void efp_merge(efp_type *efp, const efp_type *other)
+{
+  efp_type tmp;
+  int i;
+
+  tmp = *other;
+  if(efp->count + tmp.count >= EFP_MAX_COUNT) {
+    carry_efp(efp);
+    carry_efp(&tmp);
+  }
+  for(i=0; i<EFP_NUMINT; i++) efp->v[i] += tmp.v[i];
+  efp->count += tmp.count;
+
+}; /* efp_merge */
+
+/*******************************************************************************
+  double efp_to_double(const efp_type *efp)
+  return the sum as a double. The integers are first brought to the same
+  sign, so the result only depends on the exact value of the sum.
+*******************************************************************************/
+double efp_to_double(const efp_type *efp)
+{
+  efp_type tmp;
+  int i, positive;
+  double r;
+
+  tmp = *efp;
+  carry_efp(&tmp);
+
+  positive = 1;
+  for(i=0; i<EFP_NUMINT; i++) {
+    if(tmp.v[i] != 0) {
+      positive = (tmp.v[i] > 0);
+      break;
+    }
+  }
+  for(i=EFP_NUMINT-1; i>0; i--) {
+    if(positive && tmp.v[i] < 0) {
+      tmp.v[i] += EFP_PREC;
+      tmp.v[i-1]--;
+    }
+    else if(!positive && tmp.v[i] > 0) {
+      tmp.v[i] -= EFP_PREC;
+      tmp.v[i-1]++;
+    }
+  }
+
+  r = 0;
+  for(i=0; i<EFP_NUMINT; i++) r += pr[i]*tmp.v[i];
+  return r;
+
+}; /* efp_to_double */
+
+/*******************************************************************************
+  void mpp_sum_efp(efp_type *efp)
+  sum efp over all the pes.
+*******************************************************************************/
+void mpp_sum_efp(efp_type *efp)
+{
+  carry_efp(efp);
+  mpp_sum_long(EFP_NUMINT, efp->v);
+  efp->count = mpp_npes();
+  carry_efp(efp);
+
+}; /* mpp_sum_efp */
@@ -0,0 +1,34 @@
+/** @file
+    @brief Reproducible sums in extended fixed point.
+
+    A double is split into EFP_NUMINT 64-bit integers holding EFP_NUMBIT
+    bits each, covering magnitudes below 2^138 with a resolution of
+    2^-138. Integer addition is exact and
+    associative, so the sum does not depend on the order of the terms, the
+    number of OpenMP threads or the number of pes. The method is that of
+    Hallberg and Adcroft (2014), also used in the FMS mpp_efp module.
+*/
+#ifndef MPP_EFP_H_
+#define MPP_EFP_H_
+#include <stddef.h>
+
+#define EFP_NUMINT 6
+#define EFP_NUMBIT 46
+
+typedef struct {
+  long long v[EFP_NUMINT];
+  int count;   /* number of terms added since the last carry */
+} efp_type;
+
+void efp_clear(efp_type *efp);
+void efp_add(efp_type *efp, double x);
+void efp_merge(efp_type *efp, const efp_type *other);
+double efp_to_double(const efp_type *efp);
+void mpp_sum_efp(efp_type *efp);
+
+/* reduction(efp_sum:var) for an efp_type var in an OpenMP loop */
+#if defined(_OPENMP) && _OPENMP >= 201307
+#pragma omp declare reduction(efp_sum : efp_type : efp_merge(&omp_out, &omp_in)) initializer(efp_clear(&omp_priv))
+#endif
+
+#endif
@@ -3,6 +3,7 @@
     @author Zhi.Liang@noaa.gov
 */
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
@@ -32,6 +33,7 @@ typedef struct {
 
 FileType files[MAXFILE];
 int      nfiles = 0;
+int      reopen_files = 0; /* set by mpp_allow_reopen */
 
 int      in_format = NC_FORMAT_NETCDF4_CLASSIC;
 
@@ -116,7 +118,7 @@ int mpp_open(const char *file, int action) {
     }
   }
   if(fid > -1) {
-    if(files[n].action == MPP_WRITE) {
+    if(files[n].action == MPP_WRITE && (files[n].status || !reopen_files)) {
       sprintf( errmsg, "mpp_io(mpp_open): %s is already created for write", file);
       mpp_error(errmsg);
     }
@@ -124,14 +126,27 @@ int mpp_open(const char *file, int action) {
       sprintf( errmsg, "mpp_io(mpp_open): %s is already opened", file);
       mpp_error(errmsg);
     }
+    /* the file may have changed since it was closed, look up its variables again */
+    if(reopen_files) files[fid].nvar = 0;
   }
   else {
-    fid = nfiles;
-    nfiles++;
-    if(nfiles > MAXFILE) mpp_error("mpp_io(mpp_open): nfiles is larger than MAXFILE, increase MAXFILE");
+    /* reuse the entry of a closed file */
+    if(reopen_files) {
+      for(n=0; n<nfiles; n++) {
+        if(!files[n].status) {
+          fid = n;
+          break;
+        }
+      }
+    }
+    if(fid < 0) {
+      fid = nfiles;
+      nfiles++;
+      if(nfiles > MAXFILE) mpp_error("mpp_io(mpp_open): nfiles is larger than MAXFILE, increase MAXFILE");
+      files[fid].var = (VarType *)malloc(MAXVAR*sizeof(VarType));
+    }
     strcpy(files[fid].name, file);
     files[fid].nvar = 0;
-    files[fid].var = (VarType *)malloc(MAXVAR*sizeof(VarType));
   }
   switch (action) {
   case MPP_WRITE:
@@ -189,6 +204,18 @@ int mpp_open(const char *file, int action) {
   return fid;
 }
 
+/*********************************************************************
+  void mpp_allow_reopen(void)
+  Let mpp_open create again an output file that was created and
+  closed before, and reuse the entries of the closed files, so a long
+  running program that opens many files in turn does not run out of
+  entries. By default an output file can only be created once.
+*********************************************************************/
+void mpp_allow_reopen(void)
+{
+  reopen_files = 1;
+}
+
 /* close the file */
 void mpp_close(int fid)
 {
@@ -1056,6 +1083,278 @@ void mpp_set_deflation(int fid_in, int fid_out, int deflation, int shuffle) {
     }
 }
 
+/**********************************************************************
+  int mpp_get_var_chunking(fid, vid, chunks)
+  Return 1 and the chunk shape in chunks when variable vid of file fid
+  is stored chunked (NetCDF4), return 0 when it is contiguous or the
+  file is NetCDF3. chunks should have at least ndim entries.
+**********************************************************************/
+int mpp_get_var_chunking(int fid, int vid, size_t *chunks)
+{
+  int status, format, storage;
+  char errmsg[512];
+
+  if(fid<0 || fid >=nfiles) mpp_error("mpp_io(mpp_get_var_chunking): invalid id number, id should be "
+                                      "a nonnegative integer that less than nfiles");
+  if(vid<0 || vid >=files[fid].nvar) mpp_error("mpp_io(mpp_get_var_chunking): invalid vid number, vid should be "
+                                               "a nonnegative integer that less than nvar");
+
+  status = nc_inq_format(files[fid].ncid, &format);
+  if(status != NC_NOERR) {
+    sprintf(errmsg, "mpp_io(mpp_get_var_chunking): Error in getting format of file %s", files[fid].name);
+    netcdf_error(errmsg, status);
+  }
+  if(format == NC_FORMAT_CLASSIC || format == NC_FORMAT_64BIT) return 0;
+
+  status = nc_inq_var_chunking(files[fid].ncid, files[fid].var[vid].fldid, &storage, chunks);
+  if(status != NC_NOERR) {
+    sprintf(errmsg, "mpp_io(mpp_get_var_chunking): Error in getting chunking of var %s from file %s",
+            files[fid].var[vid].name, files[fid].name);
+    netcdf_error(errmsg, status);
+  }
+
+  return (storage == NC_CHUNKED);
+
+}; /* mpp_get_var_chunking */
+
+/**********************************************************************
+  void mpp_set_read_cache(fid, vid, block)
+  Size the chunk cache of a chunked input variable so that every chunk
+  touched while reading a block of shape block[ndim] stays resident.
+  Successive slab reads that fall in the same chunks (e.g. consecutive
+  levels of a field chunked along z, or consecutive records of a field
+  chunked along t) are then served from the cache instead of
+  decompressing the chunks again. When the block needs more cache than
+  the environment variable NC_READ_CACHE_MAX allows (default 256M, K
+  and M suffixes accepted), only the chunks of one horizontal slab of
+  the block are kept. Nothing is done for contiguous variables.
+**********************************************************************/
+void mpp_set_read_cache(int fid, int vid, const size_t *block)
+{
+  int status, ndim, i;
+  size_t chunks[NC_MAX_VAR_DIMS];
+  size_t chunk_bytes, nchunks, nchunks_slab, cache_size, cache_max;
+  size_t cache_nelems, cur_size;
+  float cache_preemption;
+  char *maxstr;
+  char errmsg[512];
+
+  if( !mpp_get_var_chunking(fid, vid, chunks) ) return;
+
+  status = nc_inq_varndims(files[fid].ncid, files[fid].var[vid].fldid, &ndim);
+  if(status != NC_NOERR) {
+    sprintf(errmsg, "mpp_io(mpp_set_read_cache): Error in getting ndims of var %s from file %s",
+            files[fid].var[vid].name, files[fid].name);
+    netcdf_error(errmsg, status);
+  }
+  if(ndim < 2) return;
+
+  switch(files[fid].var[vid].type) {
+  case NC_DOUBLE:
+    chunk_bytes = 8;
+    break;
+  case NC_SHORT:
+    chunk_bytes = 2;
+    break;
+  case NC_BYTE: case NC_CHAR:
+    chunk_bytes = 1;
+    break;
+  default:
+    chunk_bytes = 4;
+  }
+
+  /* most chunks a block can touch when it is not chunk aligned */
+  nchunks = 1;
+  nchunks_slab = 1;
+  for(i=0; i<ndim; i++) {
+    size_t n;
+    n = (block[i]+chunks[i]-2)/chunks[i] + 1;
+    chunk_bytes *= chunks[i];
+    nchunks *= n;
+    if(i >= ndim-2) nchunks_slab *= n;
+  }
+
+  cache_max = 256*1024*1024;
+  maxstr = getenv("NC_READ_CACHE_MAX");
+  if(maxstr && strlen(maxstr) > 0) {
+    char *end;
+    unsigned long val;
+    size_t unit;
+
+    val = strtoul(maxstr, &end, 10);
+    unit = 1;
+    if( *end == 'K' ) {
+      unit = 1024;
+      end++;
+    }
+    else if( *end == 'M' ) {
+      unit = 1024*1024;
+      end++;
+    }
+    if( maxstr[0] > '9' || maxstr[0] < '0' || *end != '\0' ) {
+      sprintf(errmsg, "mpp_io(mpp_set_read_cache): environment variable NC_READ_CACHE_MAX = %.64s "
+              "should be digits optionally followed by 'K' or 'M'", maxstr);
+      mpp_error(errmsg);
+    }
+    if( (size_t)val > SIZE_MAX/unit )
+      cache_max = SIZE_MAX;
+    else
+      cache_max = (size_t)val*unit;
+  }
+
+  cache_size = nchunks*chunk_bytes;
+  if(cache_size > cache_max) {
+    nchunks    = nchunks_slab;
+    cache_size = nchunks*chunk_bytes;
+  }
+
+  status = nc_get_var_chunk_cache(files[fid].ncid, files[fid].var[vid].fldid, &cur_size, &cache_nelems, &cache_preemption);
+  if(status != NC_NOERR) {
+    sprintf(errmsg, "mpp_io(mpp_set_read_cache): Error in getting chunk cache of var %s in file %s",
+            files[fid].var[vid].name, files[fid].name);
+    netcdf_error(errmsg, status);
+  }
+  if(cache_size <= cur_size && nchunks <= cache_nelems) return;
+
+  /* the hash table should be well larger than the number of resident chunks */
+  if(cache_nelems < 4*nchunks) cache_nelems = 4*nchunks+1;
+  if(cache_size < cur_size) cache_size = cur_size;
+  status = nc_set_var_chunk_cache(files[fid].ncid, files[fid].var[vid].fldid, cache_size, cache_nelems, 0.75);
+  if(status != NC_NOERR) {
+    sprintf(errmsg, "mpp_io(mpp_set_read_cache): Error in setting chunk cache of var %s in file %s",
+            files[fid].var[vid].name, files[fid].name);
+    netcdf_error(errmsg, status);
+  }
+
+}; /* mpp_set_read_cache */
+
+/**********************************************************************
+  void mpp_set_output_layout(fid, vid, quantize_nsd)
+  Set the NetCDF4 storage layout of a regridded output field. The field
+  is chunked so that one chunk holds one horizontal level of the tile
+  (every leading dimension is chunked by 1), which matches the
+  level-by-level writes of the regridding tools. The per-variable chunk
+  cache is sized to hold that chunk. When quantize_nsd > 0 and the field
+  is floating point, the data is quantized to keep quantize_nsd
+  significant digits so that deflation compresses it better.
+  Nothing is done for NetCDF3 output.
+**********************************************************************/
+void mpp_set_output_layout(int fid, int vid, int quantize_nsd)
+{
+  int status, format, ncid, fldid, ndim, i;
+  int dimids[NC_MAX_VAR_DIMS];
+  size_t chunks[NC_MAX_VAR_DIMS];
+  size_t len, chunk_bytes, cache_size, cache_nelems;
+  float cache_preemption;
+  nc_type type;
+  char errmsg[512];
+
+  if( mpp_pe() != mpp_root_pe() ) return;
+
+  if(fid<0 || fid >=nfiles) mpp_error("mpp_io(mpp_set_output_layout): invalid id number, id should be "
+                                      "a nonnegative integer that less than nfiles");
+  if(vid<0 || vid >=files[fid].nvar) mpp_error("mpp_io(mpp_set_output_layout): invalid vid number, vid should be "
+                                               "a nonnegative integer that less than nvar");
+  ncid  = files[fid].ncid;
+  fldid = files[fid].var[vid].fldid;
+
+  status = nc_inq_format(ncid, &format);
+  if(status != NC_NOERR) {
+    sprintf(errmsg, "mpp_io(mpp_set_output_layout): Error in getting format of file %s", files[fid].name);
+    netcdf_error(errmsg, status);
+  }
+  if(format == NC_FORMAT_CLASSIC || format == NC_FORMAT_64BIT) return;
+
+  status = nc_inq_varndims(ncid, fldid, &ndim);
+  if(status != NC_NOERR) {
+    sprintf(errmsg, "mpp_io(mpp_set_output_layout): Error in getting ndims of var %s from file %s",
+            files[fid].var[vid].name, files[fid].name);
+    netcdf_error(errmsg, status);
+  }
+  /* only fields with a horizontal extent are given an explicit layout */
+  if(ndim < 2) return;
+
+  status = nc_inq_vardimid(ncid, fldid, dimids);
+  if(status != NC_NOERR) {
+    sprintf(errmsg, "mpp_io(mpp_set_output_layout): Error in getting dimids of var %s from file %s",
+            files[fid].var[vid].name, files[fid].name);
+    netcdf_error(errmsg, status);
+  }
+  status = nc_inq_vartype(ncid, fldid, &type);
+  if(status != NC_NOERR) {
+    sprintf(errmsg, "mpp_io(mpp_set_output_layout): Error in getting type of var %s from file %s",
+            files[fid].var[vid].name, files[fid].name);
+    netcdf_error(errmsg, status);
+  }
+
+  /* one chunk is one full (y,x) level of the tile */
+  switch(type) {
+  case NC_DOUBLE:
+    chunk_bytes = 8;
+    break;
+  case NC_SHORT:
+    chunk_bytes = 2;
+    break;
+  case NC_BYTE: case NC_CHAR:
+    chunk_bytes = 1;
+    break;
+  default:
+    chunk_bytes = 4;
+  }
+  for(i=0; i<ndim; i++) {
+    if(i < ndim-2)
+      chunks[i] = 1;
+    else {
+      status = nc_inq_dimlen(ncid, dimids[i], &len);
+      if(status != NC_NOERR) {
+        sprintf(errmsg, "mpp_io(mpp_set_output_layout): Error in getting dimension length of var %s from file %s",
+                files[fid].var[vid].name, files[fid].name);
+        netcdf_error(errmsg, status);
+      }
+      chunks[i] = len>0 ? len : 1;
+    }
+    chunk_bytes *= chunks[i];
+  }
+
+  status = nc_def_var_chunking(ncid, fldid, NC_CHUNKED, chunks);
+  if(status != NC_NOERR) {
+    sprintf(errmsg, "mpp_io(mpp_set_output_layout): Error in setting chunking of var %s in file %s",
+            files[fid].var[vid].name, files[fid].name);
+    netcdf_error(errmsg, status);
+  }
+
+  /* Each level is written exactly once, so the cache only needs to hold the
+     chunk being filled. Never shrink below the library default. */
+  status = nc_get_var_chunk_cache(ncid, fldid, &cache_size, &cache_nelems, &cache_preemption);
+  if(status != NC_NOERR) {
+    sprintf(errmsg, "mpp_io(mpp_set_output_layout): Error in getting chunk cache of var %s in file %s",
+            files[fid].var[vid].name, files[fid].name);
+    netcdf_error(errmsg, status);
+  }
+  if(chunk_bytes > cache_size) {
+    status = nc_set_var_chunk_cache(ncid, fldid, chunk_bytes, cache_nelems, 1.0);
+    if(status != NC_NOERR) {
+      sprintf(errmsg, "mpp_io(mpp_set_output_layout): Error in setting chunk cache of var %s in file %s",
+              files[fid].var[vid].name, files[fid].name);
+      netcdf_error(errmsg, status);
+    }
+  }
+
+  if(quantize_nsd > 0 && (type == NC_FLOAT || type == NC_DOUBLE)) {
+#ifdef NC_QUANTIZE_BITGROOM
+    status = nc_def_var_quantize(ncid, fldid, NC_QUANTIZE_BITGROOM, quantize_nsd);
+    if(status != NC_NOERR) {
+      sprintf(errmsg, "mpp_io(mpp_set_output_layout): Error in setting quantization of var %s in file %s",
+              files[fid].var[vid].name, files[fid].name);
+      netcdf_error(errmsg, status);
+    }
+#else
+    mpp_error("mpp_io(mpp_set_output_layout): quantization requires NetCDF 4.9.0 or later");
+#endif
+  }
+
+}; /* mpp_set_output_layout */
+
 /**********************************************************************
   void mpp_copy_var_att(fid_in, fid_out)
   copy all the field attribute from infile to outfile
@@ -18,6 +18,7 @@
 
 int mpp_open(const char *file, int action);
 void mpp_close(int ncid);
+void mpp_allow_reopen(void); /* closed files may be created or opened again */
 int mpp_get_nvars(int fid);
 void mpp_get_varname(int fid, int varid, char *name);
 int mpp_get_varid(int fid, const char *varname);
@@ -59,6 +60,9 @@ int mpp_var_exist(int fid, const char *field);
 int mpp_dim_exist(int fid, const char *dimname);
 int get_great_circle_algorithm(int fid);
 void mpp_set_deflation(int fid_in, int fid_out, int deflation, int shuffle);
+void mpp_set_output_layout(int fid, int vid, int quantize_nsd);
+int mpp_get_var_chunking(int fid, int vid, size_t *chunks);
+void mpp_set_read_cache(int fid, int vid, const size_t *block);
 void set_in_format(char *format);
 void reset_in_format(int format);
 #endif
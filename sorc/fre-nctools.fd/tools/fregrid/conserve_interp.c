@@ -13,12 +13,99 @@
 #include "conserve_interp.h"
 #include "fregrid_util.h"
 #include "mpp.h"
+#include "mpp_efp.h"
 #include "mpp_io.h"
 #include "read_mosaic.h"
 
 #define  AREA_RATIO (1.e-3)
 #define  MAXVAL (1.e20)
 #define  TOLERANCE  (1.e-10)
+/* output cells per row block of the streamed first order exchange grid */
+#define  XGRID_BLOCK_CELLS (100000)
+
+/* exchange grid weights of interp, stored in double or, with WEIGHT_R4, in float */
+#define XGRID_AREA(interp, n) ((interp).area_r4 ? (double)(interp).area_r4[n] : (interp).area[n])
+#define XGRID_DI(interp, n)   ((interp).di_in_r4 ? (double)(interp).di_in_r4[n] : (interp).di_in[n])
+#define XGRID_DJ(interp, n)   ((interp).dj_in_r4 ? (double)(interp).dj_in_r4[n] : (interp).dj_in[n])
+
+/*******************************************************************************
+  static void weight_to_r4(Interp_config *interp, int order2)
+  replace the double precision exchange grid weights of interp by single
+  precision copies.
+*******************************************************************************/
+static void weight_to_r4(Interp_config *interp, int order2)
+{
+  size_t i, nxgrid;
+
+  nxgrid = interp->nxgrid;
+  if(nxgrid == 0) return;
+  interp->area_r4 = (float *)malloc(nxgrid*sizeof(float));
+  for(i=0; i<nxgrid; i++) interp->area_r4[i] = interp->area[i];
+  free(interp->area);
+  interp->area = NULL;
+  if(order2) {
+    interp->di_in_r4 = (float *)malloc(nxgrid*sizeof(float));
+    interp->dj_in_r4 = (float *)malloc(nxgrid*sizeof(float));
+    for(i=0; i<nxgrid; i++) {
+      interp->di_in_r4[i] = interp->di_in[i];
+      interp->dj_in_r4[i] = interp->dj_in[i];
+    }
+    free(interp->di_in);
+    free(interp->dj_in);
+    interp->di_in = NULL;
+    interp->dj_in = NULL;
+  }
+
+}; /* weight_to_r4 */
+
+/* destination of the exchange grid cells streamed from one input tile */
+typedef struct {
+  Interp_config *interp;
+  size_t        size;     /* allocated length of the interp arrays */
+  int           tile_in;
+  int           jstart;   /* offset of the input rows passed to the exchange grid */
+} Xgrid_append;
+
+/*******************************************************************************
+  static void append_xgrid(...)
+  xgrid_sink of create_xgrid_2dx2d_order1_stream: append the exchange grid
+  cells of one row block to the exchange grid of an output tile, growing the
+  arrays as needed.
+*******************************************************************************/
+static void append_xgrid(int nxgrid, const int *i_in, const int *j_in, const int *i_out, const int *j_out,
+			 const double *xgrid_area, void *sink_data)
+{
+  Xgrid_append  *app = (Xgrid_append *)sink_data;
+  Interp_config *interp = app->interp;
+  size_t i, n0;
+
+  n0 = interp->nxgrid;
+  if(n0 + nxgrid > app->size) {
+    size_t size;
+    size = 2*app->size;
+    if(size < n0 + nxgrid) size = n0 + nxgrid;
+    interp->i_in  = (int    *)realloc(app->size ? interp->i_in  : NULL, size*sizeof(int   ));
+    interp->j_in  = (int    *)realloc(app->size ? interp->j_in  : NULL, size*sizeof(int   ));
+    interp->i_out = (int    *)realloc(app->size ? interp->i_out : NULL, size*sizeof(int   ));
+    interp->j_out = (int    *)realloc(app->size ? interp->j_out : NULL, size*sizeof(int   ));
+    interp->t_in  = (int    *)realloc(app->size ? interp->t_in  : NULL, size*sizeof(int   ));
+    interp->area  = (double *)realloc(app->size ? interp->area  : NULL, size*sizeof(double));
+    if(!interp->i_in || !interp->j_in || !interp->i_out || !interp->j_out || !interp->t_in || !interp->area)
+      mpp_error("conserve_interp: not enough memory for the exchange grid");
+    app->size = size;
+  }
+  for(i=0; i<nxgrid; i++) {
+    interp->t_in [n0+i] = app->tile_in;
+    interp->i_in [n0+i] = i_in[i];
+    interp->j_in [n0+i] = j_in[i] + app->jstart;
+    interp->i_out[n0+i] = i_out[i];
+    interp->j_out[n0+i] = j_out[i];
+    interp->area [n0+i] = xgrid_area[i];
+  }
+  interp->nxgrid += nxgrid;
+
+}; /* append_xgrid */
+
 /*******************************************************************************
   void setup_conserve_interp
   Setup the interpolation weight for conservative interpolation
@@ -43,6 +130,12 @@ void setup_conserve_interp(int ntiles_in, const Grid_config *grid_in, int ntiles
 
   garea = 4*M_PI*RADIUS*RADIUS;
 
+  for(n=0; n<ntiles_out; n++) {
+    interp[n].area_r4  = NULL;
+    interp[n].di_in_r4 = NULL;
+    interp[n].dj_in_r4 = NULL;
+  }
+
   if( opcode & READ) {
     for(n=0; n<ntiles_out; n++) {
       if( interp[n].file_exist ) { /* reading from file */
@@ -130,9 +223,13 @@ void setup_conserve_interp(int ntiles_in, const Grid_config *grid_in, int ntiles
       }
     }
     for(n=0; n<ntiles_out; n++) {
+      Xgrid_append app;
+
       nx_out    = grid_out[n].nxc;
       ny_out    = grid_out[n].nyc;
       interp[n].nxgrid = 0;
+      app.interp = interp+n;
+      app.size   = 0;
       for(m=0; m<ntiles_in; m++) {
 	double *mask;
 	double y_min, y_max, yy;
@@ -168,10 +265,14 @@ void setup_conserve_interp(int ntiles_in, const Grid_config *grid_in, int ntiles
 	  ny_now = jend-jstart+1;
 
 	  if(opcode & CONSERVE_ORDER1) {
-	    nxgrid = create_xgrid_2dx2d_order1(&nx_in, &ny_now, &nx_out, &ny_out, grid_in[m].lonc+jstart*(nx_in+1),
-					       grid_in[m].latc+jstart*(nx_in+1),  grid_out[n].lonc,  grid_out[n].latc,
-					       mask, i_in, j_in, i_out, j_out, xgrid_area);
-	    for(i=0; i<nxgrid; i++) j_in[i] += jstart;
+	    /* the cells go straight to interp[n], in blocks of output rows, so the
+	       exchange grid is not limited by MAXXGRID */
+	    app.tile_in = m;
+	    app.jstart  = jstart;
+	    create_xgrid_2dx2d_order1_stream(&nx_in, &ny_now, &nx_out, &ny_out, grid_in[m].lonc+jstart*(nx_in+1),
+					     grid_in[m].latc+jstart*(nx_in+1),  grid_out[n].lonc,  grid_out[n].latc,
+					     mask, max(1, XGRID_BLOCK_CELLS/max(1, nx_out)), append_xgrid, &app);
+	    nxgrid = 0;
 	  }
 	  else if(opcode & CONSERVE_ORDER2) {
 	    int g_nxgrid;
@@ -430,6 +531,12 @@ void setup_conserve_interp(int ntiles_in, const Grid_config *grid_in, int ntiles
     if(mpp_pe() == mpp_root_pe())printf("NOTE: done calculating index and weight for conservative interpolation\n");
   }
 
+  /* the remap file, if written, keeps the double precision weights */
+  if(opcode & WEIGHT_R4) {
+    for(n=0; n<ntiles_out; n++) weight_to_r4(interp+n, opcode & CONSERVE_ORDER2);
+    if(mpp_pe() == mpp_root_pe())printf("NOTE: exchange grid weights are stored in single precision\n");
+  }
+
   /* check the input area match exchange grid area */
   if(opcode & CHECK_CONSERVE) {
     int nx1, ny1, max_i, max_j, i, j;
@@ -446,7 +553,7 @@ void setup_conserve_interp(int ntiles_in, const Grid_config *grid_in, int ntiles
       for(i=0; i<nx1*ny1; i++) area2[i] = 0;
       for(i=0; i<interp[n].nxgrid; i++) {
 	ii = interp[n].j_out[i]*nx1 + interp[n].i_out[i];
-	area2[ii] +=  interp[n].area[i];
+	area2[ii] +=  XGRID_AREA(interp[n], i);
       }
       max_ratio = 0;
       max_i = 0;
@@ -471,6 +578,38 @@ void setup_conserve_interp(int ntiles_in, const Grid_config *grid_in, int ntiles
 
     free(area2);
 
+    /* reproducible global sums of the output cell area and the exchange grid area */
+    {
+      efp_type gsum_cell, gsum_xgrid;
+      const double *cell_area;
+      double sum_cell, sum_xgrid;
+      int nsize;
+      size_t nxg, l;
+
+      efp_clear(&gsum_cell);
+      efp_clear(&gsum_xgrid);
+      for(n=0; n<ntiles_out; n++) {
+	cell_area    = grid_out[n].cell_area;
+	nsize        = grid_out[n].nxc*grid_out[n].nyc;
+	nxg          = interp[n].nxgrid;
+#if defined(_OPENMP) && _OPENMP >= 201307
+#pragma omp parallel for default(none) shared(nsize,cell_area) reduction(efp_sum:gsum_cell)
+#endif
+	for(i=0; i<nsize; i++) efp_add(&gsum_cell, cell_area[i]);
+#if defined(_OPENMP) && _OPENMP >= 201307
+#pragma omp parallel for default(none) shared(nxg,interp,n) reduction(efp_sum:gsum_xgrid)
+#endif
+	for(l=0; l<nxg; l++) efp_add(&gsum_xgrid, XGRID_AREA(interp[n], l));
+      }
+      mpp_sum_efp(&gsum_cell);
+      mpp_sum_efp(&gsum_xgrid);
+      sum_cell  = efp_to_double(&gsum_cell);
+      sum_xgrid = efp_to_double(&gsum_xgrid);
+      if(mpp_pe() == mpp_root_pe())
+	printf("NOTE: global area of the output grid = %g, of the exchange grid = %g, ratio change = %g\n",
+	       sum_cell, sum_xgrid, fabs(sum_cell-sum_xgrid)/sum_cell);
+    }
+
   }
 
   free(i_in);
@@ -483,6 +622,117 @@ void setup_conserve_interp(int ntiles_in, const Grid_config *grid_in, int ntiles
 
 }; /* setup_conserve_interp */
 
+/*******************************************************************************
+  void setup_monotone_workspace
+  Allocate the limiter workspace of the monotonic scheme once for the whole run.
+  It holds nz levels of every input tile and the largest exchange grid, and is
+  reused by every call of do_scalar_conserve_interp.
+*******************************************************************************/
+void setup_monotone_workspace(int ntiles_in, const Grid_config *grid_in, int ntiles_out,
+			      const Interp_config *interp, int nz, Monotone_workspace *mono)
+{
+  int n, nx, ny;
+
+  mono->nz = nz;
+  mono->ntiles = ntiles_in;
+  mono->nxgrid = 0;
+  for(n=0; n<ntiles_out; n++) mono->nxgrid = max(mono->nxgrid, interp[n].nxgrid);
+  mono->xdata = (double *)malloc(max(mono->nxgrid,1)*nz*sizeof(double));
+  mono->tile = (Monotone_config *)malloc(ntiles_in*sizeof(Monotone_config));
+  for(n=0; n<ntiles_in; n++) {
+    nx = grid_in[n].nx;
+    ny = grid_in[n].ny;
+    mono->tile[n].f_bar_max = (double *)malloc(nx*ny*nz*sizeof(double));
+    mono->tile[n].f_bar_min = (double *)malloc(nx*ny*nz*sizeof(double));
+    mono->tile[n].f_max     = (double *)malloc(nx*ny*nz*sizeof(double));
+    mono->tile[n].f_min     = (double *)malloc(nx*ny*nz*sizeof(double));
+    mono->tile[n].row_max   = (double *)malloc(nx*(ny+2)*sizeof(double));
+    mono->tile[n].row_min   = (double *)malloc(nx*(ny+2)*sizeof(double));
+  }
+
+}; /* setup_monotone_workspace */
+
+void free_monotone_workspace(Monotone_workspace *mono)
+{
+  int n;
+
+  for(n=0; n<mono->ntiles; n++) {
+    free(mono->tile[n].f_bar_max);
+    free(mono->tile[n].f_bar_min);
+    free(mono->tile[n].f_max);
+    free(mono->tile[n].f_min);
+    free(mono->tile[n].row_max);
+    free(mono->tile[n].row_min);
+  }
+  free(mono->tile);
+  free(mono->xdata);
+  mono->tile = NULL;
+  mono->xdata = NULL;
+  mono->ntiles = 0;
+
+}; /* free_monotone_workspace */
+
+/*******************************************************************************
+  void set_monotone_bound
+  f_bar_max/f_bar_min of a cell are the max/min of the source data over its 3x3
+  neighborhood (data has a halo of 1), missing values excluded. The stencil is
+  split into a 3-point pass along each row and a 3-point pass across rows, both
+  unit stride in i, and done for all nz levels in one sweep.
+*******************************************************************************/
+static void set_monotone_bound(int nx, int ny, int nz, const double *data, double missing,
+			       Monotone_config *mono)
+{
+  int i, j, k;
+  double *rmax, *rmin;
+
+  rmax = mono->row_max;
+  rmin = mono->row_min;
+  for(k=0; k<nz; k++) {
+    const double *dk = data + k*(nx+2)*(ny+2);
+    double *bmax = mono->f_bar_max + k*nx*ny;
+    double *bmin = mono->f_bar_min + k*nx*ny;
+
+    for(j=0; j<ny+2; j++) {
+      const double *d = dk + j*(nx+2);
+      double *r1 = rmax + j*nx;
+      double *r2 = rmin + j*nx;
+#if defined(_OPENMP) && _OPENMP >= 201307
+#pragma omp simd
+#endif
+      for(i=0; i<nx; i++) {
+	double a = d[i], b = d[i+1], c = d[i+2];
+	double hi, lo;
+	hi = (a == missing) ? -MAXVAL : a;
+	lo = (a == missing) ?  MAXVAL : a;
+	if(b != missing) { hi = (b > hi) ? b : hi; lo = (b < lo) ? b : lo; }
+	if(c != missing) { hi = (c > hi) ? c : hi; lo = (c < lo) ? c : lo; }
+	r1[i] = hi;
+	r2[i] = lo;
+      }
+    }
+
+    for(j=0; j<ny; j++) {
+      const double *a1 = rmax + j*nx, *b1 = a1 + nx, *c1 = b1 + nx;
+      const double *a2 = rmin + j*nx, *b2 = a2 + nx, *c2 = b2 + nx;
+      double *p1 = bmax + j*nx;
+      double *p2 = bmin + j*nx;
+#if defined(_OPENMP) && _OPENMP >= 201307
+#pragma omp simd
+#endif
+      for(i=0; i<nx; i++) {
+	double hi = a1[i], lo = a2[i];
+	hi = (b1[i] > hi) ? b1[i] : hi;
+	hi = (c1[i] > hi) ? c1[i] : hi;
+	lo = (b2[i] < lo) ? b2[i] : lo;
+	lo = (c2[i] < lo) ? c2[i] : lo;
+	p1[i] = hi;
+	p2[i] = lo;
+      }
+    }
+  }
+
+}; /* set_monotone_bound */
+
 
 /*******************************************************************************
  void do_scalar_conserve_interp( )
@@ -490,7 +740,7 @@ void setup_conserve_interp(int ntiles_in, const Grid_config *grid_in, int ntiles
 *******************************************************************************/
 void do_scalar_conserve_interp(Interp_config *interp, int varid, int ntiles_in, const Grid_config *grid_in,
 			       int ntiles_out, const Grid_config *grid_out, const Field_config *field_in,
-			       Field_config *field_out, unsigned int opcode, int nz)
+			       Field_config *field_out, unsigned int opcode, int nz, Monotone_workspace *mono)
 {
   int nx1, ny1, nx2, ny2, i1, j1, i2, j2, tile, n, m, i, j, n1, n2;
   int k, n0;
@@ -500,12 +750,12 @@ void do_scalar_conserve_interp(Interp_config *interp, int varid, int ntiles_in,
   double area, missing, di, dj, area_missing;
   double *out_area;
   int    *out_miss;
-  double gsum_out;
+  efp_type gsum_out;
   int monotonic;
   int target_grid;
-  Monotone_config *monotone_data;
+  Monotone_config *monotone_data=NULL;
 
-  gsum_out = 0;
+  efp_clear(&gsum_out);
   interp_method = field_in->var[varid].interp_method;
   halo = 0;
   monotonic = 0;
@@ -530,7 +780,14 @@ void do_scalar_conserve_interp(Interp_config *interp, int varid, int ntiles_in,
   if( nz>1 && cell_methods == CELL_METHODS_SUM ) mpp_error("conserve_interp: cell_methods should not be sum when nz > 1");
   /*  if( nz>1 && monotonic ) mpp_error("conserve_interp: monotonic should be false when nz > 1"); */
 
-  if(monotonic) monotone_data = (Monotone_config *)malloc(ntiles_in*sizeof(Monotone_config));
+  /* f_bar_max/f_bar_min only depend on the source data, get them once for all output tiles */
+  if(monotonic) {
+    if( !mono || !mono->tile ) mpp_error("conserve_interp: monotone workspace is not set up");
+    if( nz > mono->nz ) mpp_error("conserve_interp: nz is larger than the monotone workspace");
+    monotone_data = mono->tile;
+    for(n=0; n<ntiles_in; n++)
+      set_monotone_bound(grid_in[n].nx, grid_in[n].ny, nz, field_in[n].data, missing, monotone_data+n);
+  }
 
   for(m=0; m<ntiles_out; m++) {
     nx2 = grid_out[m].nxc;
@@ -550,7 +807,7 @@ void do_scalar_conserve_interp(Interp_config *interp, int varid, int ntiles_in,
 	  i1   = interp[m].i_in [n];
 	  j1   = interp[m].j_in [n];
 	  tile = interp[m].t_in [n];
-	  area = interp[m].area [n];
+	  area = XGRID_AREA(interp[m], n);
 	  nx1  = grid_in[tile].nx;
 	  ny1  = grid_in[tile].ny;
           if(weight_exist) area *= grid_in[tile].weight[j1*nx1+i1];
@@ -580,7 +837,7 @@ void do_scalar_conserve_interp(Interp_config *interp, int varid, int ntiles_in,
 	  i1   = interp[m].i_in [n];
 	  j1   = interp[m].j_in [n];
 	  tile = interp[m].t_in [n];
-	  area = interp[m].area [n];
+	  area = XGRID_AREA(interp[m], n);
 	  nx1  = grid_in[tile].nx;
 	  ny1  = grid_in[tile].ny;
 	  if(weight_exist) area *= grid_in[tile].weight[j1*nx1+i1];
@@ -599,130 +856,123 @@ void do_scalar_conserve_interp(Interp_config *interp, int varid, int ntiles_in,
       }
     }
     else if(monotonic) {
-      int ii, jj;
+      size_t nxgrid, nk;
       double f_bar;
       double *xdata;
+
       for(n=0; n<ntiles_in; n++) {
-	nx1 =  grid_in[n].nx;
-	ny1 =  grid_in[n].ny;
-	monotone_data[n].f_bar_max = (double *)malloc(nx1*ny1*sizeof(double));
-	monotone_data[n].f_bar_min = (double *)malloc(nx1*ny1*sizeof(double));
-	monotone_data[n].f_max     = (double *)malloc(nx1*ny1*sizeof(double));
-	monotone_data[n].f_min     = (double *)malloc(nx1*ny1*sizeof(double));
-	for(j=0; j<ny1; j++) for(i=0; i<nx1; i++) {
-	  n1 = j*nx1+i;
-
-	  monotone_data[n].f_bar_max[n1] = -MAXVAL;
-	  monotone_data[n].f_bar_min[n1] = MAXVAL;
-	  monotone_data[n].f_max[n1]     = -MAXVAL;
-	  monotone_data[n].f_min[n1]     = MAXVAL;
-	  n1 = j*nx1+i;
-	  for(jj=j-1; jj<=j+1; jj++) for(ii=i-1; ii<=i+1; ii++) {
-	    n2 = (jj+1)*(nx1+2)+ii+1;
-	    if( field_in[n].data[n2] != missing ) {
-	      if( field_in[n].data[n2] > monotone_data[n].f_bar_max[n1] ) monotone_data[n].f_bar_max[n1] = field_in[n].data[n2];
-	      if( field_in[n].data[n2] < monotone_data[n].f_bar_min[n1] ) monotone_data[n].f_bar_min[n1] = field_in[n].data[n2];
-	    }
-	  }
+	double *f_max = monotone_data[n].f_max;
+	double *f_min = monotone_data[n].f_min;
+	int     size  = grid_in[n].nx*grid_in[n].ny*nz;
+	for(i=0; i<size; i++) {
+	  f_max[i] = -MAXVAL;
+	  f_min[i] =  MAXVAL;
 	}
       }
 
-      xdata = (double *)malloc(interp[m].nxgrid*sizeof(double));
-      for(n=0; n<interp[m].nxgrid; n++) {
+      nxgrid = interp[m].nxgrid;
+      xdata = mono->xdata;
+      for(n=0; n<nxgrid; n++) {
 	i1   = interp[m].i_in [n];
 	j1   = interp[m].j_in [n];
-	di   = interp[m].di_in[n];
-	dj   = interp[m].dj_in[n];
+	di   = XGRID_DI(interp[m], n);
+	dj   = XGRID_DJ(interp[m], n);
 	tile = interp[m].t_in [n];
-	n1 = j1*nx1+i1;
-        n2 = (j1+1)*(nx1+2)+i1+1;
-	if( field_in[tile].data[n2] != missing ) {
-	  if( field_in[tile].grad_mask[n1] ) { /* use zero gradient */
-	    xdata[n] = field_in[tile].data[n2];
-	  }
-	  else {
-	    xdata[n] = field_in[tile].data[n2]+field_in[tile].grad_x[n1]*di+field_in[tile].grad_y[n1]*dj;
-	  }
-	  if(monotonic) {
-	    if( xdata[n] > monotone_data[tile].f_max[n1]) monotone_data[tile].f_max[n1] = xdata[n];
-	    if( xdata[n] < monotone_data[tile].f_min[n1]) monotone_data[tile].f_min[n1] = xdata[n];
+	nx1  = grid_in[tile].nx;
+	ny1  = grid_in[tile].ny;
+	for(k=0; k<nz; k++) {
+	  n1 = k*nx1*ny1 + j1*nx1+i1;
+	  n2 = k*(nx1+2)*(ny1+2) + (j1+1)*(nx1+2)+i1+1;
+	  nk = k*nxgrid + n;
+	  if( field_in[tile].data[n2] != missing ) {
+	    if( field_in[tile].grad_mask[n1] ) { /* use zero gradient */
+	      xdata[nk] = field_in[tile].data[n2];
+	    }
+	    else {
+	      xdata[nk] = field_in[tile].data[n2]+field_in[tile].grad_x[n1]*di+field_in[tile].grad_y[n1]*dj;
+	    }
+	    if( xdata[nk] > monotone_data[tile].f_max[n1]) monotone_data[tile].f_max[n1] = xdata[nk];
+	    if( xdata[nk] < monotone_data[tile].f_min[n1]) monotone_data[tile].f_min[n1] = xdata[nk];
 	  }
+	  else
+	    xdata[nk] = missing;
 	}
-	else
-	  xdata[n] = missing;
       }
 
       /* get the global f_max and f_min */
       if(mpp_npes() >1) {
 	for(n=0; n<ntiles_in; n++) {
-	  mpp_min_double(nx1*ny1, monotone_data[n].f_min);
-	  mpp_max_double(nx1*ny1, monotone_data[n].f_max);
+	  mpp_min_double(grid_in[n].nx*grid_in[n].ny*nz, monotone_data[n].f_min);
+	  mpp_max_double(grid_in[n].nx*grid_in[n].ny*nz, monotone_data[n].f_max);
 	}
       }
 
       /* adjust the exchange grid cell data to make it monotonic */
-      for(n=0; n<interp[m].nxgrid; n++) {
+      for(n=0; n<nxgrid; n++) {
 	i1   = interp[m].i_in [n];
 	j1   = interp[m].j_in [n];
 	tile = interp[m].t_in [n];
-	n1 = j1*nx1+i1;
-	n2 = (j1+1)*(nx1+2)+i1+1;
-	f_bar = field_in[tile].data[n2];
-	if(xdata[n] == missing) continue;
-
-	if( monotone_data[tile].f_max[n1] > monotone_data[tile].f_bar_max[n1] ) {
-	  /* z1l: Due to truncation error, we might get xdata[n] > f_bar_max[n1]. So
-	     we allow some tolerance. What is the suitable tolerance? */
-	  xdata[n] = f_bar + ((xdata[n]-f_bar)/(monotone_data[tile].f_max[n1]-f_bar))
-	    * (monotone_data[tile].f_bar_max[n1]-f_bar);
-	  if( xdata[n] > monotone_data[tile].f_bar_max[n1]) {
-	    if(xdata[n] - monotone_data[tile].f_bar_max[n1] < TOLERANCE ) xdata[n] = monotone_data[tile].f_bar_max[n1];
-	    if( xdata[n] > monotone_data[tile].f_bar_max[n1]) {
-	      printf(" n = %d, n1 = %d, xdata = %f, f_bar_max=%f\n", n, n1, xdata[n], monotone_data[tile].f_bar_max[n1]);
-	      mpp_error(" xdata is greater than f_bar_max ");
+	nx1  = grid_in[tile].nx;
+	ny1  = grid_in[tile].ny;
+	for(k=0; k<nz; k++) {
+	  n1 = k*nx1*ny1 + j1*nx1+i1;
+	  n2 = k*(nx1+2)*(ny1+2) + (j1+1)*(nx1+2)+i1+1;
+	  nk = k*nxgrid + n;
+	  f_bar = field_in[tile].data[n2];
+	  if(xdata[nk] == missing) continue;
+
+	  if( monotone_data[tile].f_max[n1] > monotone_data[tile].f_bar_max[n1] ) {
+	    /* z1l: Due to truncation error, we might get xdata[n] > f_bar_max[n1]. So
+	       we allow some tolerance. What is the suitable tolerance? */
+	    xdata[nk] = f_bar + ((xdata[nk]-f_bar)/(monotone_data[tile].f_max[n1]-f_bar))
+	      * (monotone_data[tile].f_bar_max[n1]-f_bar);
+	    if( xdata[nk] > monotone_data[tile].f_bar_max[n1]) {
+	      if(xdata[nk] - monotone_data[tile].f_bar_max[n1] < TOLERANCE ) xdata[nk] = monotone_data[tile].f_bar_max[n1];
+	      if( xdata[nk] > monotone_data[tile].f_bar_max[n1]) {
+		printf(" n = %d, n1 = %d, xdata = %f, f_bar_max=%f\n", n, n1, xdata[nk], monotone_data[tile].f_bar_max[n1]);
+		mpp_error(" xdata is greater than f_bar_max ");
+	      }
 	    }
 	  }
-	}
-	else if( monotone_data[tile].f_min[n1] < monotone_data[tile].f_bar_min[n1] ) {
-	  /* z1l: Due to truncation error, we might get xdata[n] < f_bar_min[n1]. So
-	     we allow some tolerance. What is the suitable tolerance? */
-	  xdata[n] = f_bar + ((xdata[n]-f_bar)/(monotone_data[tile].f_min[n1]-f_bar)) * (monotone_data[tile].f_bar_min[n1]-f_bar);
-	  if( xdata[n] < monotone_data[tile].f_bar_min[n1]) {
-	    if(monotone_data[tile].f_bar_min[n1] - xdata[n]< TOLERANCE ) xdata[n] = monotone_data[tile].f_bar_min[n1];
-	    if( xdata[n] < monotone_data[tile].f_bar_min[n1]) {
-	      printf(" n = %d, n1 = %d, xdata = %f, f_bar_min=%f\n", n, n1, xdata[n], monotone_data[tile].f_bar_min[n1]);
-	      mpp_error(" xdata is less than f_bar_min ");
+	  else if( monotone_data[tile].f_min[n1] < monotone_data[tile].f_bar_min[n1] ) {
+	    /* z1l: Due to truncation error, we might get xdata[n] < f_bar_min[n1]. So
+	       we allow some tolerance. What is the suitable tolerance? */
+	    xdata[nk] = f_bar + ((xdata[nk]-f_bar)/(monotone_data[tile].f_min[n1]-f_bar)) * (monotone_data[tile].f_bar_min[n1]-f_bar);
+	    if( xdata[nk] < monotone_data[tile].f_bar_min[n1]) {
+	      if(monotone_data[tile].f_bar_min[n1] - xdata[nk]< TOLERANCE ) xdata[nk] = monotone_data[tile].f_bar_min[n1];
+	      if( xdata[nk] < monotone_data[tile].f_bar_min[n1]) {
+		printf(" n = %d, n1 = %d, xdata = %f, f_bar_min=%f\n", n, n1, xdata[nk], monotone_data[tile].f_bar_min[n1]);
+		mpp_error(" xdata is less than f_bar_min ");
+	      }
 	    }
 	  }
 	}
       }
-      for(n=0; n<ntiles_in; n++) {
-	free(monotone_data[n].f_bar_max);
-	free(monotone_data[n].f_bar_min);
-	free(monotone_data[n].f_max);
-	free(monotone_data[n].f_min);
-      }
 
       /* remap onto destination grid */
-      for(n=0; n<interp[m].nxgrid; n++) {
+      for(n=0; n<nxgrid; n++) {
 	i2   = interp[m].i_out[n];
 	j2   = interp[m].j_out[n];
 	i1   = interp[m].i_in [n];
 	j1   = interp[m].j_in [n];
 	tile = interp[m].t_in [n];
-	area = interp[m].area [n];
-	if(xdata[n] == missing) continue;
+	area = XGRID_AREA(interp[m], n);
+	nx1  = grid_in[tile].nx;
+	ny1  = grid_in[tile].ny;
 	if(weight_exist) area *= grid_in[tile].weight[j1*nx1+i1];
-	n1 = j1*nx1+i1;
-	n0 = j2*nx2+i2;
-	if( cell_methods == CELL_METHODS_SUM )
-	  area /= grid_in[tile].cell_area[n1];
-	else if( cell_measures )
-	  area *= (field_in[tile].area[n1]/grid_in[tile].cell_area[n1]);
-	field_out[m].data[n0] += xdata[n]*area;
-	out_area[n0] += area;
+	for(k=0; k<nz; k++) {
+	  nk = k*nxgrid + n;
+	  if(xdata[nk] == missing) continue;
+	  n1 = k*nx1*ny1 + j1*nx1+i1;
+	  n0 = k*nx2*ny2 + j2*nx2+i2;
+	  if( cell_methods == CELL_METHODS_SUM )
+	    area /= grid_in[tile].cell_area[n1];
+	  else if( cell_measures )
+	    area *= (field_in[tile].area[n1]/grid_in[tile].cell_area[n1]);
+	  field_out[m].data[n0] += xdata[nk]*area;
+	  out_area[n0] += area;
+	}
       }
-      free(xdata);
     }
     else {
       if(has_missing) {
@@ -731,10 +981,10 @@ void do_scalar_conserve_interp(Interp_config *interp, int varid, int ntiles_in,
 	  j2   = interp[m].j_out[n];
 	  i1   = interp[m].i_in [n];
 	  j1   = interp[m].j_in [n];
-	  di   = interp[m].di_in[n];
-	  dj   = interp[m].dj_in[n];
+	  di   = XGRID_DI(interp[m], n);
+	  dj   = XGRID_DJ(interp[m], n);
 	  tile = interp[m].t_in [n];
-	  area = interp[m].area [n];
+	  area = XGRID_AREA(interp[m], n);
 	  nx1  = grid_in[tile].nx;
 	  ny1  = grid_in[tile].ny;
 
@@ -771,10 +1021,10 @@ void do_scalar_conserve_interp(Interp_config *interp, int varid, int ntiles_in,
 	  j2   = interp[m].j_out[n];
 	  i1   = interp[m].i_in [n];
 	  j1   = interp[m].j_in [n];
-	  di   = interp[m].di_in[n];
-	  dj   = interp[m].dj_in[n];
+	  di   = XGRID_DI(interp[m], n);
+	  dj   = XGRID_DJ(interp[m], n);
 	  tile = interp[m].t_in [n];
-	  area = interp[m].area [n];
+	  area = XGRID_AREA(interp[m], n);
 
 	  nx1  = grid_in[tile].nx;
 	  ny1  = grid_in[tile].ny;
@@ -797,8 +1047,13 @@ void do_scalar_conserve_interp(Interp_config *interp, int varid, int ntiles_in,
     }
 
     if(opcode & CHECK_CONSERVE) {
-      for(i=0; i<nx2*ny2*nz; i++) {
-	if(out_area[i] > 0) gsum_out += field_out[m].data[i];
+      const double *data_out = field_out[m].data;
+      int nsize = nx2*ny2*nz;
+#if defined(_OPENMP) && _OPENMP >= 201307
+#pragma omp parallel for default(none) shared(nsize,out_area,data_out) reduction(efp_sum:gsum_out)
+#endif
+      for(i=0; i<nsize; i++) {
+	if(out_area[i] > 0) efp_add(&gsum_out, data_out[i]);
       }
     }
 
@@ -830,7 +1085,7 @@ void do_scalar_conserve_interp(Interp_config *interp, int varid, int ntiles_in,
 	  i1   = interp[m].i_in [n];
 	  j1   = interp[m].j_in [n];
 	  tile = interp[m].t_in [n];
-	  area = interp[m].area [n];
+	  area = XGRID_AREA(interp[m], n);
 	  nx1  = grid_in[tile].nx;
 	  ny1  = grid_in[tile].ny;
 	  n0 = j2*nx2+i2;
@@ -854,39 +1109,48 @@ void do_scalar_conserve_interp(Interp_config *interp, int varid, int ntiles_in,
   }
 
 
-  /* conservation check if needed */
+  /* conservation check if needed. The sums are reproducible: they do not
+     depend on the number of threads or pes, see mpp_efp.h */
   if(opcode & CHECK_CONSERVE) {
-    double gsum_in, dd;
-    gsum_in = 0;
+    efp_type gsum_in;
+    double dd, sum_in, sum_out;
+    efp_clear(&gsum_in);
     for(n=0; n<ntiles_in; n++) {
+      const double *data_in = field_in[n].data;
+      const double *wgt;
+      int nk, nxh, nyh;
 
       nx1  = grid_in[n].nx;
       ny1  = grid_in[n].ny;
-
-
-      if( cell_measures ) {
-        for(j=0; j<ny1; j++) for(i=0; i<nx1; i++) {
-  	  dd = field_in[n].data[(j+halo)*(nx1+2*halo)+i+halo];
-	  if(dd != missing) gsum_in += dd*field_in[n].area[j*nx1+i];
-        }
-      }
-      else if ( cell_methods == CELL_METHODS_SUM ) {
-        for(j=0; j<ny1; j++) for(i=0; i<nx1; i++) {
-	  dd = field_in[n].data[(j+halo)*(nx1+2*halo)+i+halo];
-	  if(dd != missing) gsum_in += dd;
-        }
-      }
+      nxh  = nx1+2*halo;
+      nyh  = ny1+2*halo;
+      /* flux is data*area, summed over the first level only for cell_measures and CELL_METHODS_SUM */
+      nk   = 1;
+      if( cell_measures )
+	wgt = field_in[n].area;
+      else if ( cell_methods == CELL_METHODS_SUM )
+	wgt = NULL;
       else {
-        for(k=0; k<nz; k++) for(j=0; j<ny1; j++) for(i=0; i<nx1; i++) {
-	  dd = field_in[n].data[k*(nx1+2*halo)*(ny1+2*halo)+(j+halo)*(nx1+2*halo)+i+halo];
-	  if(dd != missing) gsum_in += dd*grid_in[n].cell_area[j*nx1+i];
-        }
+	wgt = grid_in[n].cell_area;
+	nk  = nz;
+      }
+#if defined(_OPENMP) && _OPENMP >= 201307
+#pragma omp parallel for collapse(2) default(none) shared(nk,nx1,ny1,nxh,nyh,halo,missing,data_in,wgt) \
+                         private(i,dd) reduction(efp_sum:gsum_in)
+#endif
+      for(k=0; k<nk; k++) for(j=0; j<ny1; j++) {
+	for(i=0; i<nx1; i++) {
+	  dd = data_in[k*nxh*nyh+(j+halo)*nxh+i+halo];
+	  if(dd != missing) efp_add(&gsum_in, wgt ? dd*wgt[j*nx1+i] : dd);
+	}
       }
     }
-    mpp_sum_double(1, &gsum_out);
+    mpp_sum_efp(&gsum_out);
+    sum_in  = efp_to_double(&gsum_in);
+    sum_out = efp_to_double(&gsum_out);
 
     if(mpp_pe() == mpp_root_pe()) printf("the flux(data*area) sum of %s: input = %g, output = %g, diff = %g. \n",
-					 field_in->var[varid].name, gsum_in, gsum_out, gsum_out-gsum_in);
+					 field_in->var[varid].name, sum_in, sum_out, sum_out-sum_in);
 
   }
 
@@ -902,27 +1166,16 @@ void do_vector_conserve_interp(Interp_config *interp, int varid, int ntiles_in,
                                const Grid_config *grid_out, const Field_config *u_in,  const Field_config *v_in,
                                Field_config *u_out, Field_config *v_out, unsigned int opcode)
 {
-  int          nx1, ny1, nx2, ny2, i1, j1, i2, j2, tile, n, m, i;
-  double       area, missing, tmp_x, tmp_y;
+  int          nx1, nx2, ny2, i1, j1, i2, j2, tile, n, m, i, n0, n1;
+  double       area, missing, tmp_x, tmp_y, norm;
   double       *out_area;
 
   missing = u_in->var[varid].missing;
-  /* first rotate input data */
-  for(n = 0; n < ntiles_in; n++) {
-    if(grid_in[n].rotate) {
-      nx1 = grid_in[n].nx;
-      ny1 = grid_in[n].ny;
-      for(i=0; i<nx1*ny1; i++) {
-	tmp_x = u_in[n].data[i];
-	tmp_y = v_in[n].data[i];
-	if( tmp_x != missing && tmp_y != missing) {
-	  u_in[n].data[i] = tmp_x * grid_in[n].cosrot[i] - tmp_y * grid_in[n].sinrot[i];
-	  v_in[n].data[i] = tmp_x * grid_in[n].sinrot[i] + tmp_y * grid_in[n].cosrot[i];
-	}
-      }
-    }
-  }
 
+  /* The input rotation is applied on the fly while walking the exchange grid, and
+     the output rotation while normalizing, so u_in and v_in are left unchanged.
+     The same is done for AGRID and BGRID, get_input_grid and get_output_grid set
+     cosrot and sinrot at the location of the velocity. */
   for(m=0; m<ntiles_out; m++) {
     nx2 = grid_out[m].nxc;
     ny2 = grid_out[m].nyc;
@@ -931,8 +1184,8 @@ void do_vector_conserve_interp(Interp_config *interp, int varid, int ntiles_in,
     for(i=0; i<nx2*ny2; i++) {
       u_out[m].data[i] = 0.0;
       v_out[m].data[i] = 0.0;
+      out_area[i] = 0.0;
     }
-    for(i=0; i<nx2*ny2; i++) out_area[i] = 0.0;
 
     for(n=0; n<interp[m].nxgrid; n++) {
       i2   = interp[m].i_out[n];
@@ -940,50 +1193,44 @@ void do_vector_conserve_interp(Interp_config *interp, int varid, int ntiles_in,
       i1   = interp[m].i_in [n];
       j1   = interp[m].j_in [n];
       tile = interp[m].t_in [n];
-      area = interp[m].area [n];
+      area = XGRID_AREA(interp[m], n);
       nx1  = grid_in[tile].nx;
-      ny1  = grid_in[tile].ny;
-      tmp_x = u_in[tile].data[j1*nx1+i1];
-      tmp_y = v_in[tile].data[j1*nx1+i1];
+      n1   = j1*nx1+i1;
+      tmp_x = u_in[tile].data[n1];
+      tmp_y = v_in[tile].data[n1];
       if( tmp_x != missing && tmp_y != missing ) {
-	u_out[m].data[j2*nx2+i2] += u_in[tile].data[j1*nx1+i1]*area;
-	v_out[m].data[j2*nx2+i2] += v_in[tile].data[j1*nx1+i1]*area;
-	out_area[j2*nx2+i2] += area;
-      }
-    }
-    if(opcode & TARGET) {
-      for(i=0; i<nx2*ny2; i++) {
-	if(out_area[i] > 0) {
-	  u_out[m].data[i] /= grid_out[m].area[i];
-	  v_out[m].data[i] /= grid_out[m].area[i];
+	n0 = j2*nx2+i2;
+	if(grid_in[tile].rotate) {
+	  double cs = grid_in[tile].cosrot[n1];
+	  double sn = grid_in[tile].sinrot[n1];
+	  u_out[m].data[n0] += (tmp_x * cs - tmp_y * sn)*area;
+	  v_out[m].data[n0] += (tmp_x * sn + tmp_y * cs)*area;
 	}
 	else {
-	  u_out[m].data[i] = missing;
-	  v_out[m].data[i] = missing;
+	  u_out[m].data[n0] += tmp_x*area;
+	  v_out[m].data[n0] += tmp_y*area;
 	}
+	out_area[n0] += area;
       }
     }
-    else {
-      for(i=0; i<nx2*ny2; i++) {
-	if(out_area[i] > 0) {
-	  u_out[m].data[i] /= out_area[i];
-	  v_out[m].data[i] /= out_area[i];
+
+    for(i=0; i<nx2*ny2; i++) {
+      if(out_area[i] > 0) {
+	norm  = (opcode & TARGET) ? grid_out[m].area[i] : out_area[i];
+	tmp_x = u_out[m].data[i]/norm;
+	tmp_y = v_out[m].data[i]/norm;
+	if(grid_out[m].rotate) {
+	  u_out[m].data[i] =  tmp_x * grid_out[m].cosrot[i] + tmp_y * grid_out[m].sinrot[i];
+	  v_out[m].data[i] = -tmp_x * grid_out[m].sinrot[i] + tmp_y * grid_out[m].cosrot[i];
 	}
 	else {
-	  u_out[m].data[i] = missing;
-	  v_out[m].data[i] = missing;
+	  u_out[m].data[i] = tmp_x;
+	  v_out[m].data[i] = tmp_y;
 	}
       }
-    }
-    /* rotate the data if needed */
-    if(grid_out[m].rotate) {
-      for(i=0; i<nx2*ny2; i++) {
-	tmp_x = u_out[m].data[i];
-	tmp_y = v_out[m].data[i];
-	if( tmp_x != missing && tmp_y != missing) {
-	  u_out[m].data[i] =  tmp_x * grid_out[m].cosrot[i] + tmp_y * grid_out[m].sinrot[i];
-	  v_out[m].data[i] = -tmp_x * grid_out[m].sinrot[i] + tmp_y * grid_out[m].cosrot[i];
-	}
+      else {
+	u_out[m].data[i] = missing;
+	v_out[m].data[i] = missing;
       }
     }
     free(out_area);
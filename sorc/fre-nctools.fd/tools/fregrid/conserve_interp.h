@@ -9,7 +9,10 @@ void setup_conserve_interp(int ntiles_in, const Grid_config *grid_in, int ntiles
 			   Grid_config *grid_out, Interp_config *interp, unsigned int opcode);
 void do_scalar_conserve_interp(Interp_config *interp, int varid, int ntiles_in, const Grid_config *grid_in,
 			       int ntiles_out, const Grid_config *grid_out, const Field_config *field_in,
-			       Field_config *field_out, unsigned int opcode, int nz);
+			       Field_config *field_out, unsigned int opcode, int nz, Monotone_workspace *mono);
+void setup_monotone_workspace(int ntiles_in, const Grid_config *grid_in, int ntiles_out,
+			      const Interp_config *interp, int nz, Monotone_workspace *mono);
+void free_monotone_workspace(Monotone_workspace *mono);
 void do_vector_conserve_interp(Interp_config *interp, int varid, int ntiles_in, const Grid_config *grid_in, int ntiles_out, 
                                const Grid_config *grid_out, const Field_config *u_in,  const Field_config *v_in,
                                Field_config *u_out, Field_config *v_out, unsigned int opcode);  
@@ -12,6 +12,7 @@
 #include <getopt.h>
 #include <math.h>
 #include <time.h>
+#include <sys/stat.h>
 #include "globals.h"
 #include "constant.h"
 #include "read_mosaic.h"
@@ -36,15 +37,17 @@ char *usage[] = {
   "          [--symmetry] [--target_grid] [--finer_step #] [--fill_missing]              ",
   "          [--center_y] [--check_conserve] [--weight_file weight_file]                 ",
   "          [--weight_field --weight_field] [--dst_vgrid dst_vgrid]                     ",
-  "          [--extrapolate] [--stop_crit #] [--standard_dimension]                      ",
+  "          [--extrapolate] [--stop_crit #] [--extrapolate_multigrid]                   ",
+  "          [--standard_dimension]                                                      ",
   "          [--associated_file_dir dir] [--format format]                               ",
-  "          [--deflation #] [--shuffle 1|0]                                             ",
+  "          [--deflation #] [--shuffle 1|0] [--quantize #]                              ",
+  "          [--weight_r4] [--job_file job_file]                                         ",
   "                                                                                      ",
   "fregrid remaps data (scalar or vector) from input_mosaic onto                         ",
   "output_mosaic.  Note that the target grid also could be specified                     ",
   "through lonBegin, lonEnd, latBegin, latEnd, nlon and nlat. Currently                  ",
-  "only T-cell scalar regridding and AGRID vector regridding is                          ",
-  "available.  Bilinear interpolation is implemented only for cubic grid                 ",
+  "only T-cell scalar regridding and AGRID or BGRID vector regridding                    ",
+  "are available.  Bilinear interpolation is implemented only for cubic grid             ",
   "vector interpolation. The interpolation algorithm used is controlled                  ",
   "by --interp_method with default 'conserve_order1'. Currently the                      ",
   "'conserve_order1', 'conserve_order2' and 'bilinear' remapping schemes                 ",
@@ -156,8 +159,9 @@ char *usage[] = {
   "                                                                                      ",
   "--test_case test_case         specify the test function to be used for testing.       ",
   "                                                                                      ",
-  "--grid_type     grid_type     specify the vector field grid location. default is      ",
-  "                              AGRID and only AGRID is implemented yet.                ",
+  "--grid_type     grid_type     specify the vector field grid location, AGRID or BGRID. ",
+  "                              Default is AGRID. BGRID velocities are rotated at the   ",
+  "                              north-east cell corner and remapped as cell values.     ",
   "                                                                                      ",
   "--symmetry                    indicate the grid is symmetry or not.                   ",
   "                                                                                      ",
@@ -206,6 +210,12 @@ char *usage[] = {
   "--stop_crit #                 The stopping criteria when extrapping data onto missing ",
   "                              points. Default is 0.005                                ",
   "                                                                                      ",
+  "--extrapolate_multigrid       When extrapolating, start the iteration at each level   ",
+  "                              from the solution on successively coarsened grids.      ",
+  "                              This greatly reduces the number of iterations for       ",
+  "                              large masked regions. With --debug, the convergence     ",
+  "                              history of each level is printed.                       ",
+  "                                                                                      ",
   "--standard_dimension          When specified, the dimension and field name for        ",
   "                              longitude and latitude axis will be 'lon' and 'lat'.    ",
   "                              'lon_bnd' and 'lat_bnd' will be longitude and latitude  ",
@@ -229,6 +239,37 @@ char *usage[] = {
   "--shuffle #                   If using NetCDF4 , use shuffle if 1 and don't use if 0  ",
   "                              Defaults to input file settings.                        ",
   "                                                                                      ",
+  "--quantize #                  If using NetCDF4 (4.9.0 or later), quantize floating    ",
+  "                              point output fields to keep # significant digits.       ",
+  "                              Default is 0 (no quantization). With NetCDF4 output,    ",
+  "                              regridded fields are always chunked one level per tile. ",
+  "                                                                                      ",
+  "--weight_r4                   Keep the exchange grid weights of conservative          ",
+  "                              interpolation in single precision, the remapped data is ",
+  "                              still accumulated in double precision. This reduces the ",
+  "                              memory of large exchange grids. The remap_file written  ",
+  "                              keeps double precision weights. Use --check_conserve to ",
+  "                              see the effect on conservation.                         ",
+  "                                                                                      ",
+  "--job_file job_file           Run fregrid as a service: the grids and the remapping   ",
+  "                              weights are set up once and kept while the jobs listed  ",
+  "                              in job_file are regridded in turn. Each line of         ",
+  "                              job_file is 'input_file output_file fld1,fld2,...',     ",
+  "                              the fields are scalar fields. Blank lines and lines     ",
+  "                              starting with '#' are skipped, a line 'quit' ends the   ",
+  "                              run. When job_file is a named pipe, fregrid waits for   ",
+  "                              more jobs at the end of the pipe until 'quit' is read.  ",
+  "                              Every job uses the remapping of --interp_method. A job  ",
+  "                              with a malformed line, a missing input file or field, or",
+  "                              a field whose interp_method attribute needs another     ",
+  "                              remapping is reported and skipped. Any other error in a ",
+  "                              job stops fregrid. A later job may write the output file",
+  "                              of an earlier job again.                                ",
+  "                              --input_dir and --output_dir apply to the jobs. Can not ",
+  "                              be used with --input_file, --output_file,               ",
+  "                              --scalar_field, --u_field, --v_field, --test_case,      ",
+  "                              --dst_vgrid or --weight_field.                          ",
+  "                                                                                      ",
   "  Example 1: Remap C48 data onto N45 grid.                                            ",          
   "             (use GFDL-CM3 data as example)                                           ",
   "   fregrid --input_mosaic C48_mosaic.nc --input_dir input_dir --input_file input_file ",
@@ -249,6 +290,355 @@ char tagname[] = "$Name: bronx-10_performance_z1l $";
 
 extern int in_format; //declared in mpp_io.c
 
+/*******************************************************************************
+  static int read_job(FILE **fp, const char *job_file, char *job)
+  the root pe reads the next job of job_file and broadcasts it to all the pes.
+  Blank lines and lines starting with '#' are skipped. At the end of a named
+  pipe, the pipe is opened again to wait for the next writer. Return 0 at the
+  end of job_file or at a 'quit' line, otherwise 1.
+*******************************************************************************/
+static int read_job(FILE **fp, const char *job_file, char *job)
+{
+  char line[MAXSTRING];
+  char *str;
+  struct stat st;
+  size_t len;
+
+  job[0] = '\0';
+  if(mpp_pe() == mpp_root_pe()) {
+    for(;;) {
+      if(!fgets(line, MAXSTRING, *fp)) {
+	if(stat(job_file, &st) == 0 && S_ISFIFO(st.st_mode)) {
+	  fclose(*fp);
+	  *fp = fopen(job_file, "r");
+	  if(!*fp) mpp_error("fregrid(read_job): can not open the job_file again");
+	  continue;
+	}
+	break;
+      }
+      len = strlen(line);
+      if(len == MAXSTRING-1 && line[len-1] != '\n')
+	mpp_error("fregrid(read_job): the job line is too long, need to increase parameter MAXSTRING");
+      while(len > 0 && (line[len-1] == '\n' || line[len-1] == '\r' || line[len-1] == ' ' || line[len-1] == '\t'))
+	line[--len] = '\0';
+      str = line;
+      while(*str == ' ' || *str == '\t') str++;
+      if(*str == '\0' || *str == '#') continue;
+      if(strcmp(str, "quit")) strcpy(job, str);
+      break;
+    }
+  }
+  mpp_broadcast_char(job, MAXSTRING);
+
+  return (job[0] != '\0');
+
+}; /* read_job */
+
+/* the grids and the remapping shared by all the jobs of the service mode */
+typedef struct {
+  int           ntiles_in, ntiles_out;
+  char          *mosaic_in, *mosaic_out;
+  char          *dir_in, *dir_out;
+  char          *associated_file_dir;
+  char          *format;
+  const char    *history;       /* the command line, each job adds its own files and fields */
+  Grid_config   *grid_in, *grid_out;
+  Bound_config  *bound_T;
+  Interp_config *interp;
+  unsigned int  opcode;         /* the remapping is set up with this opcode */
+  int           kbegin, kend, lbegin, lend;
+  int           deflation, shuffle, quantize;
+  int           extrapolate;
+  double        stop_crit;
+  unsigned int  finer_step;
+  int           fill_missing;
+} Service_config;
+
+/* the files and the scalar fields of one job */
+typedef struct {
+  int           nscalar;
+  char          history[MAXATT];
+  File_config   *file_in, *file_out;
+  Field_config  *scalar_in, *scalar_out;
+} Job_config;
+
+/*******************************************************************************
+  static int setup_job(const Service_config *srv, const char *job, int njob, Job_config *jb)
+  parse the job line 'input_file output_file fld1,fld2,...', open the input
+  files and create the output files of the job. A job with a wrong format, a
+  missing input file or field, or fields that need another remapping scheme
+  than the one set up is reported and skipped. Return 1 when the job is ready
+  to be remapped, 0 when the job has no field to remap and -1 when the job is
+  skipped. Errors found while reading the metadata of the files still stop
+  the program.
+*******************************************************************************/
+static int setup_job(const Service_config *srv, const char *job, int njob, Job_config *jb)
+{
+  char entry[MAXSTRING], txt[STRING];
+  char input_file[STRING], output_file[STRING];
+  char scalar_name[NVAR][STRING];
+  char remap_method[STRING];
+  char *job_in, *job_out, *job_fields;
+  unsigned int nscalar;
+  int n, l, vid, in_format_0;
+  VGrid_config vgrid_out;
+
+  strcpy(entry, job);
+  job_in     = strtok(entry, " \t");
+  job_out    = strtok(NULL, " \t");
+  job_fields = strtok(NULL, " \t");
+  if(!job_fields || strtok(NULL, " \t")) {
+    if(mpp_pe() == mpp_root_pe())
+      printf("NOTE from fregrid: job %d is skipped, it should be 'input_file output_file fld1,fld2,...'\n", njob);
+    return -1;
+  }
+  if(strlen(job_in) >= STRING || strlen(job_out) >= STRING) {
+    if(mpp_pe() == mpp_root_pe())
+      printf("NOTE from fregrid: job %d is skipped, the file name is longer than STRING\n", njob);
+    return -1;
+  }
+  strcpy(input_file, job_in);
+  strcpy(output_file, job_out);
+  tokenize(job_fields, ",", STRING, NVAR, (char *)scalar_name, &nscalar);
+  if(mpp_pe() == mpp_root_pe()) printf("fregrid: job %d, %s\n", njob, job);
+
+  /* history is the command line plus the job */
+  if(strlen(srv->history) + strlen(job_in) + strlen(job_out) + MAXENTRY + 64 >= MAXATT)
+    mpp_error("fregrid: the history of the job is too long, need to increase parameter MAXATT");
+  if(strlen(job_fields) > MAXENTRY)
+    sprintf(jb->history, "%s --input_file %s --output_file %s --scalar_field (**please see the field list in this file**)",
+	    srv->history, job_in, job_out);
+  else
+    sprintf(jb->history, "%s --input_file %s --output_file %s --scalar_field %s", srv->history, job_in, job_out, job_fields);
+
+  set_mosaic_data_file(srv->ntiles_in, srv->mosaic_in, srv->dir_in, jb->file_in, input_file);
+  set_mosaic_data_file(srv->ntiles_out, srv->mosaic_out, srv->dir_out, jb->file_out, output_file);
+
+  for(n=0; n<srv->ntiles_in; n++) {
+    if(!mpp_file_exist(jb->file_in[n].name)) {
+      if(mpp_pe() == mpp_root_pe())
+	printf("NOTE from fregrid: job %d is skipped, can not open %s\n", njob, jb->file_in[n].name);
+      return -1;
+    }
+  }
+
+  //Open the input files. Save the nc format of the first one.
+  in_format_0 = -1;
+  for(n=0; n<srv->ntiles_in; n++) {
+    jb->file_in[n].fid = mpp_open(jb->file_in[n].name, MPP_READ);
+    if(n == 0) in_format_0 = in_format;
+  }
+
+  /* check the fields and filter the fields with interp_method = "none" */
+  jb->nscalar = 0;
+  for(l=0; l<(int)nscalar; l++) {
+    if(!mpp_var_exist(jb->file_in[0].fid, scalar_name[l])) {
+      sprintf(txt, "field %.64s is not in %.128s", scalar_name[l], jb->file_in[0].name);
+      break;
+    }
+    vid = mpp_get_varid(jb->file_in[0].fid, scalar_name[l]);
+    if(mpp_var_att_exist(jb->file_in[0].fid, vid, "interp_method")) {
+      strcpy(remap_method, "");
+      mpp_get_var_att(jb->file_in[0].fid, vid, "interp_method", remap_method);
+      if(!strcmp(remap_method, "none") || !strcmp(remap_method, "NONE") || !strcmp(remap_method, "None")) continue;
+      /* the remapping of conserve_order1 can not be used for a conserve_order2 field */
+      if(!strcmp(remap_method, "conserve_order2") && (srv->opcode & CONSERVE_ORDER1) && !(srv->opcode & MONOTONIC)) {
+	sprintf(txt, "field %.64s has interp_method conserve_order2, use --interp_method conserve_order2", scalar_name[l]);
+	break;
+      }
+    }
+    if(jb->nscalar != l) strcpy(scalar_name[jb->nscalar], scalar_name[l]);
+    jb->nscalar++;
+  }
+  if(l < (int)nscalar) {
+    if(mpp_pe() == mpp_root_pe()) printf("NOTE from fregrid: job %d is skipped, %s\n", njob, txt);
+    for(n=0; n<srv->ntiles_in; n++) mpp_close(jb->file_in[n].fid);
+    return -1;
+  }
+
+  if(jb->nscalar == 0) {
+    if(mpp_pe() == mpp_root_pe()) printf("NOTE from fregrid: no scalar field of job %d need to be regridded.\n", njob);
+    return 0;
+  }
+
+  jb->scalar_in  = (Field_config *)malloc(srv->ntiles_in *sizeof(Field_config));
+  jb->scalar_out = (Field_config *)malloc(srv->ntiles_out*sizeof(Field_config));
+  set_field_struct(srv->ntiles_in,  jb->scalar_in,  jb->nscalar, scalar_name[0], jb->file_in);
+  set_field_struct(srv->ntiles_out, jb->scalar_out, jb->nscalar, scalar_name[0], jb->file_out);
+
+  get_input_metadata(srv->ntiles_in, 1, jb->file_in, NULL, jb->scalar_in, NULL, NULL, srv->grid_in,
+		     srv->kbegin, srv->kend, srv->lbegin, srv->lend, srv->opcode, srv->associated_file_dir);
+
+  set_weight_inf(srv->ntiles_in, srv->grid_in, NULL, NULL, jb->file_in->has_cell_measure_att);
+
+  if(srv->format != NULL)
+    set_in_format(srv->format);
+  else if(in_format_0 >= 0)
+    reset_in_format(in_format_0);
+
+  vgrid_out.nz = 0;
+  set_output_metadata(srv->ntiles_in, 1, jb->file_in, NULL, jb->scalar_in, NULL, NULL,
+		      srv->ntiles_out, jb->file_out, NULL, jb->scalar_out, NULL, NULL, srv->grid_out, &vgrid_out,
+		      jb->history, tagname, srv->opcode, srv->deflation, srv->shuffle, srv->quantize);
+
+  return 1;
+
+}; /* setup_job */
+
+/*******************************************************************************
+  static void remap_job(const Service_config *srv, Job_config *jb)
+  remap the scalar fields of the job with the remapping set up for the
+  service and close the output files.
+*******************************************************************************/
+static void remap_job(const Service_config *srv, Job_config *jb)
+{
+  Monotone_workspace monotone;
+  int m, l, n, level_z, level_n, level_t, nz;
+
+  get_field_attribute(srv->ntiles_in, jb->scalar_in);
+  copy_field_attribute(srv->ntiles_out, jb->scalar_in, jb->scalar_out);
+
+  /* the monotone limiter workspace is sized once for the deepest scalar field */
+  monotone.tile = NULL;
+  if(srv->opcode & MONOTONIC) {
+    int nz_mono = 1;
+    if(srv->extrapolate) {
+      for(l=0; l<jb->nscalar; l++) nz_mono = max(nz_mono, jb->scalar_in->var[l].nz);
+    }
+    setup_monotone_workspace(srv->ntiles_in, srv->grid_in, srv->ntiles_out, srv->interp, nz_mono, &monotone);
+  }
+
+  for(m=0; m<jb->file_in->nt; m++) {
+    write_output_time(srv->ntiles_out, jb->file_out, m);
+    for(l=0; l<jb->nscalar; l++) {
+      if( !jb->scalar_in->var[l].has_taxis && m>0) continue;
+      if( !jb->scalar_in->var[l].do_regrid ) continue;
+      level_t = m + jb->scalar_in->var[l].lstart;
+      for(level_n=0; level_n < jb->scalar_in->var[l].nn; level_n++) {
+	if(srv->extrapolate) {
+	  nz = jb->scalar_in->var[l].nz;
+	  get_input_data(srv->ntiles_in, jb->scalar_in, srv->grid_in, srv->bound_T, l, -1, level_n, level_t,
+			 srv->extrapolate, srv->stop_crit);
+	  allocate_field_data(srv->ntiles_out, jb->scalar_out, srv->grid_out, nz);
+	  if( srv->opcode & BILINEAR )
+	    do_scalar_bilinear_interp(srv->interp, l, srv->ntiles_in, srv->grid_in, srv->grid_out, jb->scalar_in,
+				      jb->scalar_out, srv->finer_step, srv->fill_missing);
+	  else
+	    do_scalar_conserve_interp(srv->interp, l, srv->ntiles_in, srv->grid_in, srv->ntiles_out, srv->grid_out,
+				      jb->scalar_in, jb->scalar_out, srv->opcode, nz, &monotone);
+	  write_field_data(srv->ntiles_out, jb->scalar_out, srv->grid_out, l, -1, level_n, m);
+	  if(jb->scalar_out->var[l].interp_method == CONSERVE_ORDER2) {
+	    for(n=0; n<srv->ntiles_in; n++) {
+	      free(jb->scalar_in[n].grad_x);
+	      free(jb->scalar_in[n].grad_y);
+	    }
+	  }
+	  for(n=0; n<srv->ntiles_in; n++) free(jb->scalar_in[n].data);
+	  for(n=0; n<srv->ntiles_out; n++) free(jb->scalar_out[n].data);
+	}
+	else {
+	  for(level_z=jb->scalar_in->var[l].kstart; level_z <= jb->scalar_in->var[l].kend; level_z++) {
+	    get_input_data(srv->ntiles_in, jb->scalar_in, srv->grid_in, srv->bound_T, l, level_z, level_n, level_t,
+			   srv->extrapolate, srv->stop_crit);
+	    allocate_field_data(srv->ntiles_out, jb->scalar_out, srv->grid_out, 1);
+	    if( srv->opcode & BILINEAR )
+	      do_scalar_bilinear_interp(srv->interp, l, srv->ntiles_in, srv->grid_in, srv->grid_out, jb->scalar_in,
+					jb->scalar_out, srv->finer_step, srv->fill_missing);
+	    else
+	      do_scalar_conserve_interp(srv->interp, l, srv->ntiles_in, srv->grid_in, srv->ntiles_out, srv->grid_out,
+					jb->scalar_in, jb->scalar_out, srv->opcode, 1, &monotone);
+	    write_field_data(srv->ntiles_out, jb->scalar_out, srv->grid_out, l, level_z, level_n, m);
+	    if(jb->scalar_out->var[l].interp_method == CONSERVE_ORDER2) {
+	      for(n=0; n<srv->ntiles_in; n++) {
+		free(jb->scalar_in[n].grad_x);
+		free(jb->scalar_in[n].grad_y);
+		free(jb->scalar_in[n].grad_mask);
+	      }
+	    }
+	    for(n=0; n<srv->ntiles_in; n++) free(jb->scalar_in[n].data);
+	    for(n=0; n<srv->ntiles_out; n++) free(jb->scalar_out[n].data);
+	  }
+	}
+      }
+    }
+  }
+
+  if(monotone.tile) free_monotone_workspace(&monotone);
+
+  if(mpp_pe() == mpp_root_pe()) {
+    for(n=0; n<srv->ntiles_out; n++) {
+      mpp_close(jb->file_out[n].fid);
+      printf("****%s\n", jb->file_out[n].name);
+    }
+  }
+
+}; /* remap_job */
+
+/*******************************************************************************
+  static void end_job(const Service_config *srv, Job_config *jb)
+  close the input files of the job and release its files and fields.
+*******************************************************************************/
+static void end_job(const Service_config *srv, Job_config *jb)
+{
+  int n;
+
+  for(n=0; n<srv->ntiles_in; n++) mpp_close(jb->file_in[n].fid);
+  if(jb->scalar_in) {
+    delete_field_memory(srv->ntiles_in, jb->scalar_in);
+    delete_field_memory(srv->ntiles_out, jb->scalar_out);
+    free(jb->scalar_in);
+    free(jb->scalar_out);
+    jb->scalar_in  = NULL;
+    jb->scalar_out = NULL;
+  }
+  delete_file_memory(srv->ntiles_in, jb->file_in);
+  delete_file_memory(srv->ntiles_out, jb->file_out);
+
+}; /* end_job */
+
+/*******************************************************************************
+  static void run_jobs(const Service_config *srv, const char *job_file)
+  service mode: regrid the jobs of job_file in turn with the remapping set up
+  once. The output file of a job may be created again by a later job.
+*******************************************************************************/
+static void run_jobs(const Service_config *srv, const char *job_file)
+{
+  FILE *job_fp = NULL;
+  char job[MAXSTRING];
+  int njobs = 0, nskipped = 0, status;
+  Job_config jb;
+
+  mpp_allow_reopen();
+  if(mpp_pe() == mpp_root_pe()) {
+    job_fp = fopen(job_file, "r");
+    if(!job_fp) mpp_error("fregrid: can not open the job_file");
+  }
+
+  jb.file_in    = (File_config *)calloc(srv->ntiles_in, sizeof(File_config));
+  jb.file_out   = (File_config *)calloc(srv->ntiles_out, sizeof(File_config));
+  jb.scalar_in  = NULL;
+  jb.scalar_out = NULL;
+
+  while(read_job(&job_fp, job_file, job)) {
+    status = setup_job(srv, job, njobs+nskipped+1, &jb);
+    if(status < 0) {
+      nskipped++;
+      continue;
+    }
+    if(status > 0) remap_job(srv, &jb);
+    end_job(srv, &jb);
+    njobs++;
+  }
+
+  free(jb.file_in);
+  free(jb.file_out);
+  if(mpp_pe() == mpp_root_pe()) {
+    fclose(job_fp);
+    printf("fregrid: %d jobs are done, %d jobs are skipped.\n", njobs, nskipped);
+  }
+
+}; /* run_jobs */
+
 int main(int argc, char* argv[])
 {
   unsigned int opcode = 0;
@@ -287,6 +677,7 @@ int main(int argc, char* argv[])
   char    history[MAXATT];
   int     fill_missing = 0;
   int     extrapolate = 0;
+  int     extrap_multigrid = 0;
   int     vertical_interp = 0;
   char    *dst_vgrid = NULL;
   double  stop_crit=0.005;
@@ -295,6 +686,9 @@ int main(int argc, char* argv[])
   int     great_circle_algorithm_in, great_circle_algorithm_out;
   int     deflation = -1;
   int     shuffle = -1;
+  int     quantize = 0;
+  int     weight_r4 = 0;
+  char    *job_file = NULL;           /* list of the jobs in service mode */
   char    *format=NULL;
   
   char          wt_file_obj[512];
@@ -317,6 +711,7 @@ int main(int argc, char* argv[])
   File_config   *file2_out  = NULL;   /* store output file information */
   Bound_config  *bound_T    = NULL;   /* store halo update information for T-cell*/
   Interp_config *interp     = NULL;   /* store remapping information */
+  Monotone_workspace monotone;        /* limiter workspace of conserve_order2_monotonic */
   int save_weight_only      = 0;
   int nthreads = 1;
   
@@ -370,6 +765,10 @@ int main(int argc, char* argv[])
     {"deflation",        required_argument, NULL, 'S'},
     {"shuffle",          required_argument, NULL, 'T'},
     {"format",           required_argument, NULL, 'U'},
+    {"quantize",         required_argument, NULL, 'V'},
+    {"extrapolate_multigrid", no_argument,  NULL, 'W'},
+    {"weight_r4",        no_argument,       NULL, 'Y'},
+    {"job_file",         required_argument, NULL, 'Z'},
     {"help",             no_argument,       NULL, 'h'},
     {0, 0, 0, 0},
   };  
@@ -522,6 +921,18 @@ int main(int argc, char* argv[])
     case 'U':
       format = optarg;
       break;
+    case 'V':
+      quantize = atoi(optarg);
+      break;
+    case 'W':
+      extrap_multigrid = 1;
+      break;
+    case 'Y':
+      weight_r4 = 1;
+      break;
+    case 'Z':
+      job_file = optarg;
+      break;
     case '?':
       errflg++;
       break;
@@ -565,7 +976,14 @@ int main(int argc, char* argv[])
     mpp_error("fregrid: interp_method must be 'conserve_order1', 'conserve_order2', 'conserve_order2_monotonic'  or 'bilinear'");
 
   save_weight_only = 0;
-  if( nfiles == 0) {
+  if(job_file) {
+    if(nfiles > 0 || nfiles_out > 0 || nscalar > 0 || nvector > 0 || nvector2 > 0)
+      mpp_error("fregrid: when --job_file is specified, --input_file, --output_file, --scalar_field, "
+		"--u_field and --v_field should not be specified");
+    if(test_case || vertical_interp || weight_field)
+      mpp_error("fregrid: --test_case, --dst_vgrid and --weight_field are not supported with --job_file");
+  }
+  else if( nfiles == 0) {
     if(nvector > 0 || nscalar > 0 || nvector2 > 0)
       mpp_error("fregrid: when --input_file is not specified, --scalar_field, --u_field and --v_field should also not be specified");
     if(!remap_file) mpp_error("fregrid: when --input_file is not specified, remap_file must be specified to save weight information");
@@ -622,6 +1040,8 @@ int main(int argc, char* argv[])
     mpp_error("fregrid: shuffle must be 0 (off) or 1 (on)");
   if (deflation < -1 || deflation > 9)
     mpp_error("fregrid: deflation must be between 0 (off) and 9");
+  if (quantize < 0 || quantize > 15)
+    mpp_error("fregrid: quantize must be between 0 (off) and 15");
   
   /* define history to be the history in the grid file */
   strcpy(history,argv[0]);
@@ -673,6 +1093,7 @@ int main(int argc, char* argv[])
   }
 
   if(check_conserve) opcode |= CHECK_CONSERVE;
+  if(weight_r4) opcode |= WEIGHT_R4;
 
   if( opcode & STANDARD_DIMENSION ) printf("fregrid: --standard_dimension is set\n");
   
@@ -751,6 +1172,10 @@ int main(int argc, char* argv[])
 
   /* when vertical_interp is set, extrapolate must be set */
   if( vertical_interp) extrapolate = 1;
+  if( extrapolate ) {
+    if(extrap_multigrid) extrapolate |= EXTRAP_MULTIGRID;
+    if(debug) extrapolate |= EXTRAP_HISTORY;
+  }
   /* vertical_interp and extrapolate is not supported for vector interpolation */
   if( nvector > 0) {
     if(vertical_interp) mpp_error("fregrid: vertical_interp is not supported for vector fields");
@@ -759,7 +1184,8 @@ int main(int argc, char* argv[])
   
   if(remap_file) set_remap_file(ntiles_out, mosaic_out, remap_file, interp, &opcode, save_weight_only);  
 
-  if(!save_weight_only) {
+  /* in service mode the files of each job are set up by setup_job */
+  if(!save_weight_only && !job_file) {
     file_in   = (File_config *)malloc(ntiles_in *sizeof(File_config));
     file_out  = (File_config *)malloc(ntiles_out*sizeof(File_config));
  
@@ -861,7 +1287,7 @@ int main(int argc, char* argv[])
     
     set_output_metadata(ntiles_in, nfiles, file_in, file2_in, scalar_in, u_in, v_in,
 			ntiles_out, file_out, file2_out, scalar_out, u_out, v_out, grid_out, &vgrid_out, history, tagname, opcode,
-			deflation, shuffle);
+			deflation, shuffle, quantize);
 
     if(debug) print_mem_usage("After set_output_metadata");
     /* when the interp_method specified through command line is CONSERVE_ORDER1, but the interp_method in the source file
@@ -943,11 +1369,54 @@ int main(int argc, char* argv[])
      return 0;     
    }
   
+   if(job_file) {
+     Service_config srv;
+
+     srv.ntiles_in  = ntiles_in;
+     srv.ntiles_out = ntiles_out;
+     srv.mosaic_in  = mosaic_in;
+     srv.mosaic_out = mosaic_out;
+     srv.dir_in     = dir_in;
+     srv.dir_out    = dir_out;
+     srv.associated_file_dir = associated_file_dir;
+     srv.format     = format;
+     srv.history    = history;
+     srv.grid_in    = grid_in;
+     srv.grid_out   = grid_out;
+     srv.bound_T    = bound_T;
+     srv.interp     = interp;
+     srv.opcode     = opcode;
+     srv.kbegin     = kbegin;
+     srv.kend       = kend;
+     srv.lbegin     = lbegin;
+     srv.lend       = lend;
+     srv.deflation  = deflation;
+     srv.shuffle    = shuffle;
+     srv.quantize   = quantize;
+     srv.extrapolate  = extrapolate;
+     srv.stop_crit    = stop_crit;
+     srv.finer_step   = finer_step;
+     srv.fill_missing = fill_missing;
+     run_jobs(&srv, job_file);
+     mpp_end();
+     return 0;
+   }
+   
    if(nscalar > 0) {
      get_field_attribute(ntiles_in, scalar_in);
      copy_field_attribute(ntiles_out, scalar_in, scalar_out);
    }
    
+   /* the monotone limiter workspace is sized once for the deepest scalar field */
+   monotone.tile = NULL;
+   if( (opcode & MONOTONIC) && nscalar > 0 ) {
+     int nz_mono = 1;
+     if(extrapolate) {
+       for(l=0; l<nscalar; l++) nz_mono = max(nz_mono, scalar_in->var[l].nz);
+     }
+     setup_monotone_workspace(ntiles_in, grid_in, ntiles_out, interp, nz_mono, &monotone);
+   }
+
    if(nvector > 0) {
      get_field_attribute(ntiles_in, u_in);
      get_field_attribute(ntiles_in, v_in);
@@ -985,7 +1454,7 @@ int main(int argc, char* argv[])
 	  if( opcode & BILINEAR ) 
 	    do_scalar_bilinear_interp(interp, l, ntiles_in, grid_in, grid_out, scalar_in, scalar_out, finer_step, fill_missing);
 	  else
-	    do_scalar_conserve_interp(interp, l, ntiles_in, grid_in, ntiles_out, grid_out, scalar_in, scalar_out, opcode, scalar_in->var[l].nz);
+	    do_scalar_conserve_interp(interp, l, ntiles_in, grid_in, ntiles_out, grid_out, scalar_in, scalar_out, opcode, scalar_in->var[l].nz, &monotone);
           if(vertical_interp) do_vertical_interp(&vgrid_in, &vgrid_out, grid_out, scalar_out, l);
 	  write_field_data(ntiles_out, scalar_out, grid_out, l, -1, level_n, m);
 	  if(scalar_out->var[l].interp_method == CONSERVE_ORDER2) {
@@ -1015,7 +1484,7 @@ int main(int argc, char* argv[])
 	      if( opcode & BILINEAR ) 
 		do_scalar_bilinear_interp(interp, l, ntiles_in, grid_in, grid_out, scalar_in, scalar_out, finer_step, fill_missing);
 	      else
-		do_scalar_conserve_interp(interp, l, ntiles_in, grid_in, ntiles_out, grid_out, scalar_in, scalar_out, opcode,1);
+		do_scalar_conserve_interp(interp, l, ntiles_in, grid_in, ntiles_out, grid_out, scalar_in, scalar_out, opcode, 1, &monotone);
               if(debug) {
 		time_end = clock();
 		time_do_interp += 1.0*(time_end - time_start)/CLOCKS_PER_SEC;
@@ -1067,6 +1536,8 @@ int main(int argc, char* argv[])
     }
   }
 
+  if(monotone.tile) free_monotone_workspace(&monotone);
+
   if(debug) {
     print_time("get_input", time_get_input);
     print_time("do_interp", time_do_interp);
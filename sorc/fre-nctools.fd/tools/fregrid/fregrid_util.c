@@ -19,8 +19,10 @@
 #define D2R (M_PI/180)
 #define R2D (180/M_PI)
 #define EPSLN10 (1.e-10)
-#define REL_COEF ( 0.9 )
 #define MAX_ITER 4000
+#define EXTRAP_NWARM 20
+#define EXTRAP_OMEGA_MAX 1.9
+#define EXTRAP_MG_MIN 8
 #define MAX_NUM_VARS 5
 
 void init_halo(double *var, int nx, int ny, int nz, int halo);
@@ -32,7 +34,11 @@ void init_var_config(Var_config *var, int interp_method);
 void fill_boundaries(int ni, int nj, double *data, int is_cyclic);
 int parse_string(const char *str1, const char *str2, char *strOut, char *errmsg);
 void do_extrapolate (int ni, int nj, int nk, const double *lon, const double *lat, const double *data_in,
-		     double *data_out, int is_cyclic, double missing_value, double stop_crit);
+		     double *data_out, int is_cyclic, double missing_value, double stop_crit, int extrap_opt);
+void set_extrap_coef(int ni, int nj, const double *lon, const double *lat,
+		     double *cfn, double *cfs, double *cfe, double *cfw);
+int extrap_level(int ni, int nj, const double *lon, const double *lat, double *x, const double *msk,
+		 int is_cyclic, double stop_crit, int multigrid, double *hist, double *resmax);
 /*******************************************************************************
   void setup_tile_data_file(Mosaic_config mosaic, const char *filename)
   This routine will setup the data file name for each tile.
@@ -95,7 +101,7 @@ void set_field_struct(int ntiles, Field_config *field, int nvar, char * varname,
     field[n].file = file[n].name;
     field[n].fid = &(file[n].fid);
     field[n].nvar = nvar;
-    field[n].var = (Var_config *)malloc(nvar*sizeof(Var_config));
+    field[n].var = (Var_config *)calloc(nvar, sizeof(Var_config));
     for(i=0; i<nvar; i++)
       strcpy(field[n].var[i].name, varname+i*STRING);
   }
@@ -230,18 +236,21 @@ void get_input_grid(int ntiles, Grid_config *grid, Bound_config *bound_T, const
 
     /* if vector, need to get rotation angle */
     /* we assume the grid is orthogonal */
+    grid[n].rotate = 0;
     if( opcode & VECTOR ) {
-      if( opcode & AGRID) {
+      if( opcode & (AGRID|BGRID) ) {
 	double *angle;
+	int    off;
+	/* the velocity is at the cell center for AGRID, at the north-east corner for BGRID */
+	off = (opcode & AGRID) ? 1 : 2;
       	angle          = (double *) malloc((2*nx[n]+1)*(2*ny[n]+1)*sizeof(double));
 	grid[n].cosrot = (double *) malloc(nx[n]*ny[n]*sizeof(double));
 	grid[n].sinrot = (double *) malloc(nx[n]*ny[n]*sizeof(double));
 	vid = mpp_get_varid(g_fid, "angle_dx");
 	mpp_get_var_value(g_fid, vid, angle);
-	grid[n].rotate = 0;
 	for(j=0; j<ny[n]; j++) for(i=0; i<nx[n]; i++) {
           m1 = j*nx[n]+i;
-	  m2 = (2*j+2)*(2*nx[n]+2)+2*i+2;
+	  m2 = (2*j+off)*(2*nx[n]+1)+2*i+off;
 	  grid[n].cosrot[m1] = cos(angle[m2]*D2R);
 	  grid[n].sinrot[m1] = sin(angle[m2]*D2R);
 	  if(fabs(grid[n].sinrot[m1]) > EPSLN10) grid[n].rotate = 1;
@@ -334,6 +343,9 @@ void get_input_grid(int ntiles, Grid_config *grid, Bound_config *bound_T, const
 			 grid[n].dx, grid[n].dy, grid[n].area, grid[n].edge_w, grid[n].edge_e,
 			 grid[n].edge_s, grid[n].edge_n, grid[n].en_n, grid[n].en_e,
 			 grid[n].vlon_t, grid[n].vlat_t, &is_true, &is_true, &is_true, &is_true);
+      grid[n].grad_wgt = (double *) malloc(8*nlon*nlat   *sizeof(double));
+      grad_c2l_weight(nlon, nlat, grid[n].dx, grid[n].dy, grid[n].area, grid[n].en_n, grid[n].en_e,
+		      grid[n].vlon_t, grid[n].vlat_t, grid[n].grad_wgt);
     }
   }
 
@@ -512,18 +524,21 @@ void get_output_grid_from_mosaic(int ntiles, Grid_config *grid, const char *mosa
 
     /* if vector, need to get rotation angle */
     /* we assume the grid is orthogonal */
+    grid[n].rotate = 0;
     if(opcode & VECTOR) {
-      if(opcode & AGRID) {
+      if(opcode & (AGRID|BGRID)) {
 	double *angle;
+	int    off;
+	/* the velocity is at the cell center for AGRID, at the north-east corner for BGRID */
+	off = (opcode & AGRID) ? 1 : 2;
 	angle          = (double *) malloc((2*nx[n]+1)*(2*ny[n]+1)*sizeof(double));
 	grid[n].cosrot = (double *) malloc(nx[n]*ny[n]*sizeof(double));
 	grid[n].sinrot = (double *) malloc(nx[n]*ny[n]*sizeof(double));
 	vid = mpp_get_varid(g_fid, "angle_dx");
 	mpp_get_var_value(g_fid, vid, angle);
-	grid[n].rotate = 0;
 	for(j=0; j<grid[n].nyc; j++) for(i=0; i<grid[n].nxc; i++) {
-	  jj = 2*(j + grid[n].jsc);
-	  ii = 2*(i + grid[n].isc);
+	  jj = 2*(j + grid[n].jsc) + off;
+	  ii = 2*(i + grid[n].isc) + off;
 	  grid[n].cosrot[j*grid[n].nxc+i] = cos(angle[jj*(2*nx[n]+1)+ii]*D2R);
 	  grid[n].sinrot[j*grid[n].nxc+i] = sin(angle[jj*(2*nx[n]+1)+ii]*D2R);
 	  if(fabs(grid[n].sinrot[j*grid[n].nxc+i]) > EPSLN10) grid[n].rotate = 1;
@@ -817,7 +832,7 @@ void get_input_metadata(int ntiles, int nfiles, File_config *file1, File_config
   char    dimname[5][STRING], bndname[5][STRING], errmsg[STRING];
   File_config  *file  = NULL;
   Field_config *field = NULL;
-  size_t start[4], nread[4];
+  size_t start[4];
   int interp_method, use_bilinear, use_conserve;
   int len, found, standard_dimension;
 
@@ -844,14 +859,14 @@ void get_input_metadata(int ntiles, int nfiles, File_config *file1, File_config
   if( u_comp) nvector = u_comp->nvar;
 
   for(n=0; n<4; n++) {
-    start[n] = 0; nread[n] = 1;
+    start[n] = 0;
   }
 
   for(m=0; m<nfiles; m++) {
     file = m==0? file1:file2;
     for(n=0; n<ntiles; n++) {
       file[n].nt        = 1;
-      file[n].axis      = (Axis_config *)malloc(MAXDIM*sizeof(Axis_config));
+      file[n].axis      = (Axis_config *)calloc(MAXDIM, sizeof(Axis_config));
       file[n].ndim      = 0;
       file[n].has_tavg_info = 0;
     }
@@ -1242,6 +1257,16 @@ void get_input_metadata(int ntiles, int nfiles, File_config *file1, File_config
 	      file[n].nt              = dimsize[0];
 	    }
 	  }
+	  /* get_input_data reads one (y,x) slab per level and the levels of a record in order,
+	     keep the chunks of one record resident so each chunk is decompressed only once */
+	  {
+	    size_t block[5];
+	    for(i=0; i<ndim-2; i++) block[i] = 1;
+	    if(field[n].var[ll].has_zaxis) block[ndim-3] = field[n].var[ll].nz;
+	    block[ndim-2] = dimsize[ndim-2];
+	    block[ndim-1] = dimsize[ndim-1];
+	    mpp_set_read_cache(file[n].fid, field[n].var[ll].vid, block);
+	  }
 	}
 	for(i=0; i<ndim; i++) {
 	  /* loop through all the file dimensions to see if the dimension already exist or not */
@@ -1281,25 +1306,21 @@ void get_input_metadata(int ntiles, int nfiles, File_config *file1, File_config
 	    }
 	    else
 	      file[n].axis[j].size = dimsize[i];
-	    file[n].axis[j].data = (double *)malloc(file[n].axis[j].size*sizeof(double));
-	    nread[0] = file[n].axis[j].size;
-	    mpp_get_var_value_block(file[n].fid, file[n].axis[j].vid, start, nread, file[n].axis[j].data);
+	    /* the axis data is only needed when it is copied to the output file, see read_axis_data */
+	    file[n].axis[j].start   = start[0];
+	    file[n].axis[j].data    = NULL;
+	    file[n].axis[j].bnddata = NULL;
 	    file[n].axis[j].bndtype = 0;
 	    if(strcmp(bndname[i], "none") ) {
 	      file[n].axis[j].bndid = mpp_get_varid(file[n].fid, bndname[i]);
 	      if(mpp_get_var_ndim(file[n].fid,file[n].axis[j].bndid) == 1) {
 		file[n].axis[j].bndtype = 1;
-		file[n].axis[j].bnddata = (double *)malloc((file[n].axis[j].size+1)*sizeof(double));
-		nread[0] = file[n].axis[j].size+1;
 	      }
 	      else {
 	        file[n].axis[j].bndtype = 2;
-		file[n].axis[j].bnddata = (double *)malloc(2*file[n].axis[j].size*sizeof(double));
-		nread[0] = file[n].axis[j].size; nread[1] = 2;
 		/* find the bnd variable name */
 		mpp_get_var_dimname(file[n].fid,file[n].axis[j].bndid, 1, orig_bnd_dimname);
 	      }
-	      mpp_get_var_value_block(file[n].fid, file[n].axis[j].bndid, start, nread, file[n].axis[j].bnddata);
 	    }
 	    else if( cart[i] == 'X' || cart[i] == 'Y' ) {
 	      sprintf(file[n].axis[j].bndname, "%s_bnds", file[n].axis[j].name);
@@ -1378,25 +1399,20 @@ void get_input_metadata(int ntiles, int nfiles, File_config *file1, File_config
 	}
       }
     }
-    /* close the file and get the tavg_info */
+    /* get the tavg_info, the data is read by read_tavg_data when it is needed */
     for(n=0; n<ntiles; n++) {
+      file[n].t1 = NULL;
+      file[n].t2 = NULL;
+      file[n].dt = NULL;
       if(file[n].has_tavg_info) {
-
-	file[n].t1    = (double *)malloc(file[n].nt*sizeof(double));
-	file[n].t2    = (double *)malloc(file[n].nt*sizeof(double));
-	file[n].dt    = (double *)malloc(file[n].nt*sizeof(double));
 	file[n].id_t1 = mpp_get_varid(file[n].fid, "average_T1");
 	file[n].id_t2 = mpp_get_varid(file[n].fid, "average_T2");
 	file[n].id_dt = mpp_get_varid(file[n].fid, "average_DT");
 	file[n].tavg_type = mpp_get_var_type(file[n].fid, file[n].id_t1);
 	if(lbegin > 0)
-	  start[0] = lbegin-1;
+	  file[n].tstart = lbegin-1;
 	else
-	  start[0] = 0;
-	nread[0] = file[n].nt; nread[1] = 1;
-	mpp_get_var_value_block(file[n].fid, file[n].id_t1, start, nread, file[n].t1);
-	mpp_get_var_value_block(file[n].fid, file[n].id_t2, start, nread, file[n].t2);
-	mpp_get_var_value_block(file[n].fid, file[n].id_dt, start, nread, file[n].dt);
+	  file[n].tstart = 0;
       }
     }
 
@@ -1409,6 +1425,65 @@ void get_input_metadata(int ntiles, int nfiles, File_config *file1, File_config
 
 }; /* get_input_metadata */
 
+/*******************************************************************************
+  static void read_axis_data(File_config *file, int j)
+  read the data and bounds of axis j of the input file the first time they are
+  used. Most axes of the input file are never read, the horizontal axes of the
+  output file come from the output grid and only the first tile is copied.
+*******************************************************************************/
+static void read_axis_data(File_config *file, int j)
+{
+  Axis_config *axis;
+  size_t start[4], nread[4];
+  int n;
+
+  axis = file->axis+j;
+  if(axis->data) return;
+
+  for(n=0; n<4; n++) {
+    start[n] = 0; nread[n] = 1;
+  }
+  start[0] = axis->start;
+  nread[0] = axis->size;
+  axis->data = (double *)malloc(axis->size*sizeof(double));
+  mpp_get_var_value_block(file->fid, axis->vid, start, nread, axis->data);
+  if(axis->bndtype == 1) {
+    axis->bnddata = (double *)malloc((axis->size+1)*sizeof(double));
+    nread[0] = axis->size+1;
+  }
+  else if(axis->bndtype == 2) {
+    axis->bnddata = (double *)malloc(2*axis->size*sizeof(double));
+    nread[0] = axis->size; nread[1] = 2;
+  }
+  if(axis->bnddata) mpp_get_var_value_block(file->fid, axis->bndid, start, nread, axis->bnddata);
+
+}; /* read_axis_data */
+
+/*******************************************************************************
+  static void read_tavg_data(File_config *file)
+  read the time average information of the input file the first time it is used.
+*******************************************************************************/
+static void read_tavg_data(File_config *file)
+{
+  size_t start[4], nread[4];
+  int n;
+
+  if(!file->has_tavg_info || file->t1) return;
+
+  for(n=0; n<4; n++) {
+    start[n] = 0; nread[n] = 1;
+  }
+  start[0] = file->tstart;
+  nread[0] = file->nt;
+  file->t1 = (double *)malloc(file->nt*sizeof(double));
+  file->t2 = (double *)malloc(file->nt*sizeof(double));
+  file->dt = (double *)malloc(file->nt*sizeof(double));
+  mpp_get_var_value_block(file->fid, file->id_t1, start, nread, file->t1);
+  mpp_get_var_value_block(file->fid, file->id_t2, start, nread, file->t2);
+  mpp_get_var_value_block(file->fid, file->id_dt, start, nread, file->dt);
+
+}; /* read_tavg_data */
+
 /* get the string after str2 in str1 and save it into strOut
    return 1 if the string is found, return 0 if not, return -1 if error found
 */
@@ -1459,17 +1534,18 @@ int parse_string(const char *str1, const char *str2, char *strOut, char *errmsg)
 void set_output_metadata ( Mosaic_config *mosaic)
 *******************************************************************************/
 
-void set_output_metadata (int ntiles_in, int nfiles, const File_config *file1_in, const File_config *file2_in,
+void set_output_metadata (int ntiles_in, int nfiles, File_config *file1_in, File_config *file2_in,
 			  const Field_config *scalar_in, const Field_config *u_in, const Field_config *v_in,
 			  int ntiles_out, File_config *file1_out, File_config *file2_out, Field_config *scalar_out,
 			  Field_config *u_out, Field_config *v_out, const Grid_config *grid_out, const VGrid_config *vgrid_out,
-			  const char *history, const char *tagname, unsigned int opcode, int deflation, int shuffle)
+			  const char *history, const char *tagname, unsigned int opcode, int deflation, int shuffle,
+			  int quantize)
 {
   int j;
   int m, n, ndim, i, l, dims[5];
   int dim_bnds, dim_time;
   int nscalar, nvector;
-  const File_config *file_in = NULL;
+  File_config *file_in = NULL;
   File_config *file_out = NULL;
   int dst_is_latlon;
   int standard_dimension;
@@ -1526,7 +1602,7 @@ void set_output_metadata (int ntiles_in, int nfiles, const File_config *file1_in
       file_out[n].nt        = file_in[0].nt;
       ndim                  = file_in[0].ndim;
       file_out[n].ndim      = ndim;
-      file_out[n].axis      = (Axis_config *)malloc(ndim*sizeof(Axis_config));
+      file_out[n].axis      = (Axis_config *)calloc(ndim, sizeof(Axis_config));
       file_out[n].has_tavg_info = file_in[0].has_tavg_info;
 
       for(i=0; i<ndim; i++) {
@@ -1561,6 +1637,7 @@ void set_output_metadata (int ntiles_in, int nfiles, const File_config *file1_in
 	    file_out[n].axis[i].data[l] = vgrid_out->z[l];
 	}
 	else {
+	  read_axis_data(file_in, i);
 	  for(l=0; l<file_out[n].axis[i].size; l++)
 	    file_out[n].axis[i].data[l] = file_in[0].axis[i].data[l];
 	}
@@ -1577,6 +1654,7 @@ void set_output_metadata (int ntiles_in, int nfiles, const File_config *file1_in
 	    for(l=0; l<=file_out[n].axis[i].size; l++) file_out[n].axis[i].bnddata[l  ] = vgrid_out->zb[l];
 	  }
 	  else{
+	    read_axis_data(file_in, i);
 	    for(l=0; l<=file_out[n].axis[i].size; l++) file_out[n].axis[i].bnddata[l] = file_in[0].axis[i].bnddata[l];
 	  }
 	  break;
@@ -1601,6 +1679,7 @@ void set_output_metadata (int ntiles_in, int nfiles, const File_config *file1_in
 	    }
 	  }
 	  else {
+	    read_axis_data(file_in, i);
 	    for(l=0; l<file_out[n].axis[i].size; l++) {
 	      file_out[n].axis[i].bnddata[2*l  ] = file_in[0].axis[i].bnddata[2*l];
 	      file_out[n].axis[i].bnddata[2*l+1] = file_in[0].axis[i].bnddata[2*l+1];
@@ -1851,6 +1930,7 @@ void set_output_metadata (int ntiles_in, int nfiles, const File_config *file1_in
 	  mpp_copy_var_att(file_in[0].fid, file_in[0].id_t2, file_out[n].fid, file_out[n].id_t2);
 	  file_out[n].id_dt = mpp_def_var(file_out[n].fid, "average_DT", file_in[0].tavg_type, 1, &dim_time, 0);
 	  mpp_copy_var_att(file_in[0].fid, file_in[0].id_dt, file_out[n].fid, file_out[n].id_dt);
+	  read_tavg_data(file_in);
 	  file_out[n].t1 = (double *)malloc(file_out[n].nt*sizeof(double));
 	  file_out[n].t2 = (double *)malloc(file_out[n].nt*sizeof(double));
 	  file_out[n].dt = (double *)malloc(file_out[n].nt*sizeof(double));
@@ -1863,6 +1943,16 @@ void set_output_metadata (int ntiles_in, int nfiles, const File_config *file1_in
 	/* set deflation and shuffle */
 	mpp_set_deflation(file_in[0].fid, file_out[n].fid, deflation, shuffle);
 
+	/* chunk the regridded fields one level per tile, optionally quantized */
+	for(l=0; l<nscalar; l++) {
+	  if( scalar_in[0].var[l].do_regrid )
+	    mpp_set_output_layout(file_out[n].fid, scalar_out[n].var[l].vid, quantize);
+	}
+	for(l=0; l<nvector; l++) {
+	  if(m==0) mpp_set_output_layout(file_out[n].fid, u_out[n].var[l].vid, quantize);
+	  if(m==1 || nfiles == 1) mpp_set_output_layout(file_out[n].fid, v_out[n].var[l].vid, quantize);
+	}
+
 	mpp_end_def(file_out[n].fid);
 
        	for(i=0; i<ndim; i++) {
@@ -2048,7 +2138,7 @@ void write_output_time(int ntiles, File_config *file, int level)
 void get_input_data(int ntiles, Field_config *field, Grid_config *grid, Bound_config *bound,
 		    int varid, int level_z, int level_n, int level_t, int extrapolate, double stop_crit)
 {
-  int         halo, i, j, k, i1, i2, n, p;
+  int         halo, i, j, k, i1, i2, n;
   int         memsize, nx, ny, ndim, nbound, l, pos, nz;
   size_t      *start, *nread;
   double      *data;
@@ -2142,7 +2232,7 @@ void get_input_data(int ntiles, Field_config *field, Grid_config *grid, Bound_co
       tmp = (double *)malloc(nx*ny*nz*sizeof(double));
       for(i=0; i<nx*ny*nz; i++) tmp[i] = data[i];
       do_extrapolate(nx, ny, nz, grid[n].lont1D, grid[n].latt1D, tmp, data, grid[n].is_cyclic,
-		     field[n].var[varid].missing, stop_crit );
+		     field[n].var[varid].missing, stop_crit, extrapolate );
       field[n].var[varid].has_missing = 0;
       free(tmp);
     }
@@ -2204,13 +2294,10 @@ void get_input_data(int ntiles, Field_config *field, Grid_config *grid, Bound_co
 	for(k=0; k<nz; k++) for(j=0; j<ny; j++) for(i=0; i<nx; i++) {
 	  field[n].grad_mask[k*nx*ny+j*nx+i] = 0;
 	}
-	for(k=0; k<nz; k++) {
-	  p = k*(nx+2)*(ny+2);
-	  grad_c2l(&(grid[n].nx), &(grid[n].ny), field[n].data+p, grid[n].dx, grid[n].dy, grid[n].area,
-		   grid[n].edge_w, grid[n].edge_e, grid[n].edge_s, grid[n].edge_n,
-		   grid[n].en_n, grid[n].en_e, grid[n].vlon_t, grid[n].vlat_t,
-		   field[n].grad_x, field[n].grad_y, &is_true, &is_true, &is_true, &is_true);
-	}
+	/* all the levels at once, level k of the gradient is at offset k*nx*ny */
+	grad_c2l_nz(nx, ny, nz, field[n].data, grid[n].grad_wgt,
+		    grid[n].edge_w, grid[n].edge_e, grid[n].edge_s, grid[n].edge_n,
+		    field[n].grad_x, field[n].grad_y, is_true, is_true, is_true, is_true);
 	/* where there is missing and using second order conservative interpolation, need to calculate mask for gradient */
 	if( field[n].var[varid].has_missing ) {
 	  int ip1, im1, jp1, jm1,kk,ii,jj;
@@ -2461,6 +2548,7 @@ void setup_boundary(const char *mosaic_file, int ntiles, Grid_config *grid, Boun
   int *tile, *dir;
   int *istart, *iend, *jstart, *jend;
 
+  for(n=0; n<ntiles; n++) bound[n].plan_nx = 0;
   ncontacts = read_mosaic_ncontacts(mosaic_file);
   if(ncontacts == 0) {
     for(n=0; n<ntiles; n++) bound[n].nbound = 0;
@@ -2596,9 +2684,83 @@ void delete_bound_memory(int ntiles, Bound_config *bound)
       free(bound[n].tile2);
       free(bound[n].rotate);
     }
+    if(bound[n].plan_nx > 0) {
+      free(bound[n].plan_nx2);
+      free(bound[n].plan_start);
+      free(bound[n].plan_src);
+      free(bound[n].plan_dst);
+      bound[n].plan_nx = 0;
+    }
   }
 }
 
+/*******************************************************************************
+  void delete_file_memory(int ntiles, File_config *file)
+  release the axis and time average data of the files set by get_input_metadata
+  or set_output_metadata, so the File_config can be used for another file.
+*******************************************************************************/
+void delete_file_memory(int ntiles, File_config *file)
+{
+  int n, i;
+
+  for(n=0; n<ntiles; n++) {
+    if(file[n].axis) {
+      for(i=0; i<file[n].ndim; i++) {
+	free(file[n].axis[i].data);
+	free(file[n].axis[i].bnddata);
+      }
+      free(file[n].axis);
+      file[n].axis = NULL;
+    }
+    free(file[n].t1);
+    free(file[n].t2);
+    free(file[n].dt);
+    file[n].t1 = NULL;
+    file[n].t2 = NULL;
+    file[n].dt = NULL;
+    file[n].has_tavg_info = 0;
+  }
+
+}; /* delete_file_memory */
+
+/*******************************************************************************
+  void delete_field_memory(int ntiles, Field_config *field)
+  release the variables of the fields set by set_field_struct and the cell
+  area read by get_input_data, and close the associated files
+  get_input_metadata opened for the cell_measures.
+*******************************************************************************/
+void delete_field_memory(int ntiles, Field_config *field)
+{
+  int n, l, n2, l2, fid, closed;
+
+  if(!field) return;
+  for(n=0; n<ntiles; n++) {
+    for(l=0; l<field[n].nvar; l++) {
+      if(!field[n].var[l].cell_measures) continue;
+      fid = field[n].var[l].area_fid;
+      if(fid == *(field[n].fid)) continue;
+      /* several fields may share one associated file */
+      closed = 0;
+      for(n2=0; n2<=n && !closed; n2++) for(l2=0; l2<field[n2].nvar; l2++) {
+	if(n2 == n && l2 == l) break;
+	if(field[n2].var[l2].cell_measures && field[n2].var[l2].area_fid == fid) {
+	  closed = 1;
+	  break;
+	}
+      }
+      if(!closed) mpp_close(fid);
+    }
+  }
+  for(n=0; n<ntiles; n++) {
+    free(field[n].var);
+    free(field[n].area);
+    field[n].var  = NULL;
+    field[n].area = NULL;
+    field[n].nvar = 0;
+  }
+
+}; /* delete_field_memory */
+
 
 /*-----------------------------------------------------------------------------
   void init_halo(double *var, int nx, int ny, int nz, int halo)
@@ -2623,14 +2785,34 @@ void init_halo(double *var, int nx, int ny, int nz, int halo)
 };/* init_halo */
 
 
-void update_halo(int nx, int ny, int nz, double *data, Bound_config *bound, Data_holder *dHold)
+/*-----------------------------------------------------------------------------
+  void setup_halo_plan(int nx, Bound_config *bound, const Data_holder *dHold)
+  Build the halo plan of bound for a tile array of width nx and the neighbour
+  arrays of dHold. The rotation of each contact is resolved here, so that
+  update_halo is a plain indexed copy.
+  ---------------------------------------------------------------------------*/
+static void setup_halo_plan(int nx, Bound_config *bound, const Data_holder *dHold)
 {
-  int nbound, n, i, j, k, l, size1, size2, nx2, ny2;
-  int is1, ie1, js1, je1, is2, ie2, js2, je2, bufsize;
-  double *buffer;
+  int nbound, n, i, j, l, npts, nx2;
+  int is1, ie1, js1, je1, is2, ie2, js2, je2;
 
   nbound = bound->nbound;
-  size1  = nx*ny;
+  if(bound->plan_nx > 0) {
+    free(bound->plan_nx2);
+    free(bound->plan_start);
+    free(bound->plan_src);
+    free(bound->plan_dst);
+  }
+  bound->plan_nx2   = (int *)malloc(nbound*sizeof(int));
+  bound->plan_start = (int *)malloc((nbound+1)*sizeof(int));
+  npts = 0;
+  for(n=0; n<nbound; n++) {
+    bound->plan_start[n] = npts;
+    npts += (bound->ie1[n]-bound->is1[n]+1)*(bound->je1[n]-bound->js1[n]+1);
+  }
+  bound->plan_start[nbound] = npts;
+  bound->plan_src = (int *)malloc(npts*sizeof(int));
+  bound->plan_dst = (int *)malloc(npts*sizeof(int));
 
   for(n=0; n<nbound; n++) {
     is1 = bound->is1[n];
@@ -2642,48 +2824,79 @@ void update_halo(int nx, int ny, int nz, double *data, Bound_config *bound, Data
     js2 = bound->js2[n];
     je2 = bound->je2[n];
     nx2 = dHold[n].nx;
-    ny2 = dHold[n].ny;
-    size2 = nx2*ny2;
-    bufsize = nz*(ie2-is2+1)*(je2-js2+1);
-    buffer = (double *)malloc(bufsize*sizeof(double));
-    /* fill the buffer */
-    l = 0;
+    bound->plan_nx2[n] = nx2;
+    l = bound->plan_start[n];
     switch(bound->rotate[n]) {
     case ZERO:
-      for(k=0; k<nz; k++) for(j=js2; j<=je2; j++) for(i=is2; i<=ie2; i++) buffer[l++] = dHold[n].data[k*size2+j*nx2+i];
+      for(j=js2; j<=je2; j++) for(i=is2; i<=ie2; i++) bound->plan_src[l++] = j*nx2+i;
       break;
     case NINETY:
-      for(k=0; k<nz; k++) for(i=ie2; i>=is2; i--) for(j=js2; j<=je2; j++) buffer[l++] = dHold[n].data[k*size2+j*nx2+i];
+      for(i=ie2; i>=is2; i--) for(j=js2; j<=je2; j++) bound->plan_src[l++] = j*nx2+i;
       break;
     case MINUS_NINETY:
-      for(k=0; k<nz; k++) for(i=is2; i<=ie2; i++) for(j=je2; j>=js2; j--) buffer[l++] = dHold[n].data[k*size2+j*nx2+i];
+      for(i=is2; i<=ie2; i++) for(j=je2; j>=js2; j--) bound->plan_src[l++] = j*nx2+i;
       break;
     case ONE_HUNDRED_EIGHTY:
-      for(k=0; k<nz; k++) for(j=je2; j>=js2; j--) for(i=ie2; i>=is2; i--) buffer[l++] = dHold[n].data[k*size2+j*nx2+i];
+      for(j=je2; j>=js2; j--) for(i=ie2; i>=is2; i--) bound->plan_src[l++] = j*nx2+i;
       break;
+    default:
+      mpp_error("fregrid_util(setup_halo_plan): invalid rotation of the contact");
     }
-    l = 0;
-    for(k=0; k<nz; k++) for(j=js1; j<=je1; j++) for(i=is1; i<=ie1; i++) data[k*size1+j*nx+i] = buffer[l++];
-    free(buffer);
+    l = bound->plan_start[n];
+    for(j=js1; j<=je1; j++) for(i=is1; i<=ie1; i++) bound->plan_dst[l++] = j*nx+i;
   }
+  bound->plan_nx = nx;
 
-}
+}; /* setup_halo_plan */
+
+/*-----------------------------------------------------------------------------
+  void update_halo(int nx, int ny, int nz, double *data, Bound_config *bound, Data_holder *dHold)
+  Fill the halo of the nz levels of data (nx*ny each) from the neighbour tiles
+  in dHold. The halo plan of bound is built on the first call and rebuilt only
+  when the array sizes change.
+  ---------------------------------------------------------------------------*/
+void update_halo(int nx, int ny, int nz, double *data, Bound_config *bound, Data_holder *dHold)
+{
+  int nbound, n, k, l, ls, le, size1, size2, new_plan;
+  const int *src, *dst;
+
+  nbound = bound->nbound;
+  if(nbound == 0) return;
+
+  new_plan = (bound->plan_nx != nx);
+  for(n=0; n<nbound && !new_plan; n++) new_plan = (bound->plan_nx2[n] != dHold[n].nx);
+  if(new_plan) setup_halo_plan(nx, bound, dHold);
+
+  src = bound->plan_src;
+  dst = bound->plan_dst;
+  size1 = nx*ny;
+  for(n=0; n<nbound; n++) {
+    ls = bound->plan_start[n];
+    le = bound->plan_start[n+1];
+    size2 = dHold[n].nx*dHold[n].ny;
+    for(k=0; k<nz; k++) {
+      double       *d1 = data + k*size1;
+      const double *d2 = dHold[n].data + k*size2;
+      for(l=ls; l<le; l++) d1[dst[l]] = d2[src[l]];
+    }
+  }
+
+}; /* update_halo */
 
 /* do_extrapolate assume the input data is on a lat-lon grid */
 
-void do_extrapolate (int ni, int nj, int nk, const double *lon, const double *lat, const double *data_in,
-		     double *data_out, int is_cyclic, double missing_value, double stop_crit)
+/*******************************************************************************
+  void set_extrap_coef(ni, nj, lon, lat, cfn, cfs, cfe, cfw)
+  Normalized five-point Laplacian coefficients on a lat-lon grid (radians).
+*******************************************************************************/
+void set_extrap_coef(int ni, int nj, const double *lon, const double *lat,
+		     double *cfn, double *cfs, double *cfe, double *cfw)
 {
-  int i, j, k, n, n1, n2, n3, n4, n5, n6;
-  double initial_guess = 0.0;
+  int i, j, n;
   double latp, latm, cfc;
   double cstr, csm, csj;
-  double resmax;
   double *dyu=NULL, *dyt=NULL;
   double *dxu=NULL, *dxt=NULL;
-  double *cfn=NULL, *cfe=NULL;
-  double *cfs=NULL, *cfw=NULL;
-  double *tmp=NULL, *sor=NULL, *res=NULL;
 
   /* construct grid factors for a sphere */
   dxu = (double *)malloc(ni*sizeof(double));
@@ -2700,10 +2913,6 @@ void do_extrapolate (int ni, int nj, int nk, const double *lon, const double *la
   for(i=1; i<ni; i++) dxt[i] = 0.5*(dxu[i] + dxu[i-1]);
   dxt[0] = dxt[1];
 
-  cfn = (double *)malloc(ni*nj*sizeof(double));
-  cfe = (double *)malloc(ni*nj*sizeof(double));
-  cfs = (double *)malloc(ni*nj*sizeof(double));
-  cfw = (double *)malloc(ni*nj*sizeof(double));
   for(j=0; j<nj; j++) {
     if (j == nj-1)
       latp = lat[j] + 0.5*(lat[j] - lat[j-1]);
@@ -2731,82 +2940,222 @@ void do_extrapolate (int ni, int nj, int nk, const double *lon, const double *la
     }
   }
 
-  tmp = (double *)malloc((ni+2)*(nj+2)*sizeof(double));
-  sor = (double *)malloc( ni   *nj    *sizeof(double));
-  res = (double *)malloc( ni   *nj    *sizeof(double));
-
-  for(n=0; n<(ni+2)*(nj+2); n++) tmp[n] = 0.0;
+  free(dxt);
+  free(dxu);
+  free(dyt);
+  free(dyu);
 
-  for(j=0; j<nj; j++) for(i=0; i<ni; i++) {
-    n = j*ni+i;
-    n1 = (j+1)*(ni+2)+i+1;
-    if( fabs(data_in[n] - missing_value) <= EPSLN10 ) tmp[n1] = initial_guess;
-  }
+} /* set_extrap_coef */
 
-  for(k=0; k<nk; k++) {
-    for(j=0; j<nj; j++) for(i=0; i<ni; i++) {
-      n = k*ni*nj + j*ni + i;
-      n1 = j*ni + i;
-      n2 = (j+1)*(ni+2) + i+1;
-      if(fabs(data_in[n] - missing_value) <= EPSLN10 )
-	sor[n1] = REL_COEF;
-      else {
-	tmp[n2] = data_in[n];
-	sor[n1] = 0.0;
+/*******************************************************************************
+  int extrap_level(ni, nj, lon, lat, x, msk, is_cyclic, stop_crit, multigrid, hist, resmax)
+  Fill the missing points (msk=1) of one level by solving Laplace's equation with
+  red-black ordered SOR. On entry x holds the valid data and the initial guess at
+  the missing points, on exit it holds the extrapolated level. Each half sweep
+  only reads points of the other color, so the rows of a sweep are updated in
+  parallel and the result does not depend on the number of threads. The
+  relaxation factor is estimated from the contraction of the first Gauss-Seidel
+  sweeps. When multigrid is set, the initial guess is first improved by solving
+  the same problem on a grid coarsened by 2 in each direction (recursively),
+  which removes the smooth error that SOR is slow to damp. The max residual of
+  each iteration is stored in hist when it is not NULL. Returns the number of
+  iterations.
+*******************************************************************************/
+int extrap_level(int ni, int nj, const double *lon, const double *lat, double *x, const double *msk,
+		 int is_cyclic, double stop_crit, int multigrid, double *hist, double *resmax)
+{
+  int i, j, n, iter, color, nmiss, niter;
+  int nx2;
+  double omega, ssq, ssq_prev, rho, rmax_switch;
+  double *cfn=NULL, *cfe=NULL;
+  double *cfs=NULL, *cfw=NULL;
+  double *tmp=NULL, *rowsq=NULL;
+
+  nmiss = 0;
+  for(n=0; n<ni*nj; n++) if(msk[n] > 0) nmiss++;
+  *resmax = 0;
+  if(nmiss == 0) return 0;
+
+  /* improve the initial guess from the coarse grid solution */
+  if(multigrid && ni >= 2*EXTRAP_MG_MIN && nj >= 2*EXTRAP_MG_MIN && nmiss < ni*nj) {
+    int nic, njc, ic, jc, ii, jj, cnt;
+    double *lonc=NULL, *latc=NULL, *xc=NULL, *mskc=NULL, resc, sum;
+
+    nic = (ni+1)/2;
+    njc = (nj+1)/2;
+    lonc = (double *)malloc(nic*sizeof(double));
+    latc = (double *)malloc(njc*sizeof(double));
+    xc   = (double *)malloc(nic*njc*sizeof(double));
+    mskc = (double *)malloc(nic*njc*sizeof(double));
+    for(ic=0; ic<nic; ic++) lonc[ic] = 2*ic+1 < ni ? 0.5*(lon[2*ic]+lon[2*ic+1]) : lon[2*ic];
+    for(jc=0; jc<njc; jc++) latc[jc] = 2*jc+1 < nj ? 0.5*(lat[2*jc]+lat[2*jc+1]) : lat[2*jc];
+    /* a coarse cell is valid when any of its fine cells is valid */
+    for(jc=0; jc<njc; jc++) for(ic=0; ic<nic; ic++) {
+      cnt = 0;
+      sum = 0;
+      for(jj=2*jc; jj<min(2*jc+2,nj); jj++) for(ii=2*ic; ii<min(2*ic+2,ni); ii++) {
+	if(msk[jj*ni+ii] == 0) {
+	  sum += x[jj*ni+ii];
+	  cnt++;
+	}
       }
-    }
-
-    fill_boundaries(ni, nj, tmp, is_cyclic);
-
-    /* iterate */
-    for(n=0; n<MAX_ITER; n++) {
-      resmax=0.0;
-      for(j=0; j<nj; j++) for(i=0; i<ni; i++) {
-	n1 = j*ni + i;
-	n2 = (j+1)*(ni+2) + i+1;
-	n3 = (j+1)*(ni+2) + i  ;
-	n4 = (j+1)*(ni+2) + i+2;
-	n5 = (j  )*(ni+2) + i+1;
-	n6 = (j+2)*(ni+2) + i+1;
-	res[n1] = cfw[n1]*tmp[n3] + cfe[n1]*tmp[n4] + cfs[n1]*tmp[n5] + cfn[n1]*tmp[n6] - tmp[n2];
+      if(cnt > 0) {
+	xc[jc*nic+ic]   = sum/cnt;
+	mskc[jc*nic+ic] = 0;
       }
-      for(j=0; j<nj; j++) for(i=0; i<ni; i++) {
-	n1 = j*ni + i;
-	n2 = (j+1)*(ni+2) + i+1;
-	res[n1] *= sor[n1];
-	tmp[n2] += res[n1];
-	resmax = max(fabs(res[n1]), resmax);
+      else {
+	sum = 0;
+	for(jj=2*jc; jj<min(2*jc+2,nj); jj++) for(ii=2*ic; ii<min(2*ic+2,ni); ii++) {
+	  sum += x[jj*ni+ii];
+	  cnt++;
+	}
+	xc[jc*nic+ic]   = sum/cnt;
+	mskc[jc*nic+ic] = 1;
       }
+    }
+    extrap_level(nic, njc, lonc, latc, xc, mskc, is_cyclic && ni%2 == 0, stop_crit, multigrid, NULL, &resc);
+    for(j=0; j<nj; j++) for(i=0; i<ni; i++) {
+      if(msk[j*ni+i] > 0) x[j*ni+i] = xc[(j/2)*nic+i/2];
+    }
+    free(lonc);
+    free(latc);
+    free(xc);
+    free(mskc);
+  }
 
-      if(resmax <= stop_crit || n == MAX_ITER-1) {
-	for(j=0; j<nj; j++) for(i=0; i<ni; i++) {
-	  n1 = k*ni*nj + j*ni + i;
-	  n2 = (j+1)*(ni+2) + i+1;
-	  data_out[n1] = tmp[n2];
+  cfn = (double *)malloc(ni*nj*sizeof(double));
+  cfe = (double *)malloc(ni*nj*sizeof(double));
+  cfs = (double *)malloc(ni*nj*sizeof(double));
+  cfw = (double *)malloc(ni*nj*sizeof(double));
+  set_extrap_coef(ni, nj, lon, lat, cfn, cfs, cfe, cfw);
+
+  nx2 = ni+2;
+  tmp   = (double *)malloc(nx2*(nj+2)*sizeof(double));
+  rowsq = (double *)malloc(nj*sizeof(double));
+  for(n=0; n<nx2*(nj+2); n++) tmp[n] = 0.0;
+  for(j=0; j<nj; j++) for(i=0; i<ni; i++) tmp[(j+1)*nx2+i+1] = x[j*ni+i];
+  fill_boundaries(ni, nj, tmp, is_cyclic);
+
+  /* Gauss-Seidel until the contraction rate can be estimated, then over-relax */
+  omega    = 1.0;
+  ssq_prev = 0;
+  rmax_switch = 0;
+  niter    = MAX_ITER-1;
+  for(iter=0; iter<MAX_ITER; iter++) {
+    double rmax = 0;
+
+    for(color=0; color<2; color++) {
+#if defined(_OPENMP)
+#pragma omp parallel for default(none) shared(ni,nj,nx2,tmp,cfn,cfs,cfe,cfw,msk,rowsq,omega,color) \
+                         reduction(max:rmax)
+#endif
+      for(j=0; j<nj; j++) {
+	const double *pc, *ps, *pn;
+	double *pt;
+	double sq = 0;
+	int ii, i0;
+
+	i0 = (j+color)%2;
+	pt = tmp + (j+1)*nx2 + 1;
+	ps = pt - nx2;
+	pn = pt + nx2;
+	pc = msk + j*ni;
+#if defined(_OPENMP) && _OPENMP >= 201307
+#pragma omp simd reduction(max:rmax) reduction(+:sq)
+#endif
+	for(ii=i0; ii<ni; ii+=2) {
+	  int nn;
+	  double r;
+	  nn = j*ni+ii;
+	  r = pc[ii]*(cfw[nn]*pt[ii-1] + cfe[nn]*pt[ii+1] + cfs[nn]*ps[ii] + cfn[nn]*pn[ii] - pt[ii]);
+	  pt[ii] += omega*r;
+	  sq += r*r;
+	  rmax = fabs(r) > rmax ? fabs(r) : rmax;
 	}
-	break;
+	if(color == 0)
+	  rowsq[j] = sq;
+	else
+	  rowsq[j] += sq;
       }
-
-      /* update boundaries */
-
       fill_boundaries(ni, nj, tmp, is_cyclic);
     }
 
-    if(mpp_pe() == mpp_root_pe() ) printf("Stopped after %d iterations, maxres = %g\n", n, resmax);
+    if(hist) hist[iter] = rmax;
+    *resmax = rmax;
+    if(rmax <= stop_crit) {
+      niter = iter;
+      break;
+    }
+
+    /* rows are summed in order so that omega does not depend on the thread count */
+    ssq = 0;
+    for(j=0; j<nj; j++) ssq += rowsq[j];
+    if(iter == EXTRAP_NWARM && ssq_prev > 0) {
+      rho = sqrt(ssq/ssq_prev);
+      omega = rho < 1 ? 2.0/(1.0 + sqrt(1.0 - rho)) : EXTRAP_OMEGA_MAX;
+      if(omega > EXTRAP_OMEGA_MAX) omega = EXTRAP_OMEGA_MAX;
+      rmax_switch = rmax;
+    }
+    /* fall back to Gauss-Seidel if over-relaxation does not converge */
+    if(iter > EXTRAP_NWARM && omega > 1 && rmax > 10*rmax_switch) omega = 1.0;
+    ssq_prev = ssq;
   }
 
-  /* release memory */
-  free(dxt);
-  free(dxu);
-  free(dyt);
-  free(dyu);
+  for(j=0; j<nj; j++) for(i=0; i<ni; i++) x[j*ni+i] = tmp[(j+1)*nx2+i+1];
+
   free(cfn);
   free(cfe);
   free(cfs);
   free(cfw);
   free(tmp);
-  free(sor);
-  free(res);
+  free(rowsq);
+
+  return niter;
+
+} /* extrap_level */
+
+void do_extrapolate (int ni, int nj, int nk, const double *lon, const double *lat, const double *data_in,
+		     double *data_out, int is_cyclic, double missing_value, double stop_crit, int extrap_opt)
+{
+  int i, k, n, niter;
+  double initial_guess = 0.0;
+  double resmax;
+  double *x=NULL, *msk=NULL, *hist=NULL;
+
+  x   = (double *)malloc(ni*nj*sizeof(double));
+  msk = (double *)malloc(ni*nj*sizeof(double));
+  if(extrap_opt & EXTRAP_HISTORY) hist = (double *)malloc(MAX_ITER*sizeof(double));
+
+  /* the solution at one level is the initial guess of the next level */
+  for(n=0; n<ni*nj; n++) x[n] = initial_guess;
+
+  for(k=0; k<nk; k++) {
+    for(n=0; n<ni*nj; n++) {
+      if(fabs(data_in[k*ni*nj+n] - missing_value) <= EPSLN10 )
+	msk[n] = 1;
+      else {
+	x[n] = data_in[k*ni*nj+n];
+	msk[n] = 0;
+      }
+    }
+
+    niter = extrap_level(ni, nj, lon, lat, x, msk, is_cyclic, stop_crit, extrap_opt & EXTRAP_MULTIGRID,
+			 hist, &resmax);
+    for(n=0; n<ni*nj; n++) data_out[k*ni*nj+n] = x[n];
+
+    if(mpp_pe() == mpp_root_pe() ) {
+      printf("Stopped after %d iterations, maxres = %g\n", niter, resmax);
+      if(hist && niter > 0) {
+	/* convergence history at iterations 1, 2, 4, ... and at the last one */
+	for(i=1; i<=niter; i*=2) printf("   level %d: iteration %d, maxres = %g\n", k+1, i, hist[i-1]);
+	printf("   level %d: iteration %d, maxres = %g\n", k+1, niter+1, hist[niter]);
+      }
+    }
+  }
+
+  free(x);
+  free(msk);
+  if(hist) free(hist);
 
 } /* do_extrapolate */
 
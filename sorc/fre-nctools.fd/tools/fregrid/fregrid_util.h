@@ -17,11 +17,12 @@ void get_input_metadata(int ntiles, int nfiles, File_config *file1, File_config
 		        Field_config *scalar, Field_config *u_comp, Field_config *v_comp,
 			const Grid_config *grid, int kbegin, int kend, int lbegin, int lend, unsigned int opcode,
                         char *associated_file_dir);
-void set_output_metadata (int ntiles_in, int nfiles, const File_config *file1_in, const File_config *file2_in,
+void set_output_metadata (int ntiles_in, int nfiles, File_config *file1_in, File_config *file2_in,
 			  const Field_config *scalar_in, const Field_config *u_in, const Field_config *v_in,
 			  int ntiles_out, File_config *file1_out, File_config *file2_out, Field_config *scalar_out,
 			  Field_config *u_out, Field_config *v_out, const Grid_config *grid_out, const VGrid_config *vgrid_out, 
-                          const char *history, const char *tagname, unsigned int opcode, int deflation, int shuffle);
+                          const char *history, const char *tagname, unsigned int opcode, int deflation, int shuffle,
+                          int quantize);
 void get_field_attribute( int ntiles, Field_config *field);
 void copy_field_attribute( int ntiles_out, Field_config *field_in, Field_config *field_out);
 void set_remap_file( int ntiles, const char *mosaic_file, const char *remap_file, Interp_config *interp, unsigned int *opcode, int save_weight_only);
@@ -38,4 +39,6 @@ void get_output_vgrid( VGrid_config *vgrid, const char *vgrid_file );
 void get_input_vgrid( VGrid_config *vgrid, const char *vgrid_file, const char *field );
 void setup_vertical_interp(VGrid_config *vgrid_in, VGrid_config *vgrid_out);
 void do_vertical_interp(VGrid_config *vgrid_in, VGrid_config *vgrid_out, Grid_config *grid_out, Field_config *field, int varid);
+void delete_file_memory(int ntiles, File_config *file);
+void delete_field_memory(int ntiles, Field_config *field);
 #endif
@@ -43,6 +43,11 @@
 #define STANDARD_DIMENSION 8192
 #define MONOTONIC       16384
 #define EXTRAPOLATE     32768
+#define WEIGHT_R4       65536
+
+/* bits of the extrapolate flag passed to get_input_data */
+#define EXTRAP_MULTIGRID 2
+#define EXTRAP_HISTORY   4
 
 /* constant for cell_methods */
 #define CELL_METHODS_MEAN  0
@@ -110,6 +115,7 @@ typedef struct {
   int  is_defined;
   double *bnddata;
   double *data; 
+  int  start;     /* offset of the data in the file, data and bnddata are read on first use */
 } Axis_config;
 
 typedef struct {
@@ -123,6 +129,7 @@ typedef struct {
   int has_cell_measure_att;
   int id_t1, id_t2, id_dt;
   double *t1, *t2, *dt;
+  int tstart;     /* first time record, t1, t2 and dt are read on first use */
 } File_config;
 
 typedef struct {
@@ -137,6 +144,9 @@ typedef struct {
   double *area;
   double *weight;
   int    *index;
+  float  *area_r4;   /* area, di_in and dj_in in single precision when WEIGHT_R4 */
+  float  *di_in_r4;  /* is set, the double arrays are then released */
+  float  *dj_in_r4;
   char   remap_file[STRING];
   int    file_exist;
 } Interp_config;
@@ -190,6 +200,7 @@ typedef struct {
   double *edge_n;
   double *vlon_t;
   double *vlat_t;
+  double *grad_wgt; /* weights of grad_c2l_nz, see grad_c2l_weight */
   double *cosrot;
   double *sinrot;
   double *weight;
@@ -205,6 +216,13 @@ typedef struct{
   int *is1, *ie1, *js1, *je1;
   int *is2, *ie2, *js2, *je2;
   int *rotate;
+  /* halo plan of update_halo: for each contact, the halo points of this tile
+     (plan_dst) and the neighbour points they copy (plan_src) in matching order */
+  int plan_nx;      /* array width the plan is built for, 0 when not built */
+  int *plan_nx2;    /* array width of the neighbour tile of each contact */
+  int *plan_start;  /* offset of each contact in plan_src/plan_dst, nbound+1 */
+  int *plan_src;
+  int *plan_dst;
 } Bound_config;
 
 typedef struct{
@@ -218,6 +236,16 @@ typedef struct{
   double *f_bar_min;
   double *f_max;
   double *f_min;
+  double *row_max;  /* row pass of the 3x3 stencil, (ny+2)*nx */
+  double *row_min;
 } Monotone_config;
 
+typedef struct{
+  int     nz;       /* number of levels the workspace is sized for */
+  size_t  nxgrid;   /* largest exchange grid over the output tiles */
+  double  *xdata;   /* exchange grid data, nxgrid*nz */
+  int     ntiles;
+  Monotone_config *tile;
+} Monotone_workspace;
+
 #endif
@@ -0,0 +1,209 @@
+/** @file
+    @brief Handle-based API for in-memory conservative remapping, built on
+    setup_conserve_interp, do_scalar_conserve_interp and
+    do_vector_conserve_interp.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "constant.h"
+#include "globals.h"
+#include "mpp.h"
+#include "conserve_interp.h"
+#include "libfregrid.h"
+
+#define D2R (M_PI/180)
+
+struct Fregrid_remap {
+  int           ntiles_in;
+  int           ntiles_out;
+  unsigned int  opcode;
+  Grid_config   *grid_in;
+  Grid_config   *grid_out;
+  Interp_config *interp;
+  Field_config  *field_in;   /* point to the caller buffers during a remap call */
+  Field_config  *field_out;
+  Field_config  *v_in;
+  Field_config  *v_out;
+  Var_config    var;
+};
+
+/*******************************************************************************
+  static void set_grid(int nx, int ny, const double *lon, const double *lat, Grid_config *grid)
+  fill the part of Grid_config used by the conservative interpolation from the
+  cell corners given in degrees. The whole tile is the compute domain.
+*******************************************************************************/
+static void set_grid(int nx, int ny, const double *lon, const double *lat, Grid_config *grid)
+{
+  int i;
+
+  if(nx < 1 || ny < 1) mpp_error("libfregrid(set_grid): nx and ny should be positive");
+  memset(grid, 0, sizeof(Grid_config));
+  grid->nx  = nx;
+  grid->ny  = ny;
+  grid->nxc = nx;
+  grid->nyc = ny;
+  grid->isc = 0;
+  grid->iec = nx-1;
+  grid->jsc = 0;
+  grid->jec = ny-1;
+  grid->lonc = (double *)malloc((nx+1)*(ny+1)*sizeof(double));
+  grid->latc = (double *)malloc((nx+1)*(ny+1)*sizeof(double));
+  for(i=0; i<(nx+1)*(ny+1); i++) {
+    grid->lonc[i] = lon[i]*D2R;
+    grid->latc[i] = lat[i]*D2R;
+  }
+
+}; /* set_grid */
+
+/*******************************************************************************
+  Fregrid_remap *fregrid_create_remap( )
+  compute the exchange grid between the input and output mosaics and keep it
+  in a new handle. When great_circle is nonzero, cell edges are great circle
+  arcs, otherwise lines of constant longitude and latitude.
+*******************************************************************************/
+Fregrid_remap *fregrid_create_remap(int ntiles_in, const int *nx_in, const int *ny_in,
+				    const double * const *lon_in, const double * const *lat_in,
+				    int ntiles_out, const int *nx_out, const int *ny_out,
+				    const double * const *lon_out, const double * const *lat_out,
+				    int great_circle)
+{
+  Fregrid_remap *remap;
+  int n;
+
+  if(ntiles_in < 1 || ntiles_out < 1) mpp_error("libfregrid(fregrid_create_remap): number of tiles should be positive");
+
+  remap = (Fregrid_remap *)malloc(sizeof(Fregrid_remap));
+  remap->ntiles_in  = ntiles_in;
+  remap->ntiles_out = ntiles_out;
+  remap->opcode     = CONSERVE_ORDER1;
+  if(great_circle) remap->opcode |= GREAT_CIRCLE;
+
+  remap->grid_in  = (Grid_config *)malloc(ntiles_in *sizeof(Grid_config));
+  remap->grid_out = (Grid_config *)malloc(ntiles_out*sizeof(Grid_config));
+  for(n=0; n<ntiles_in; n++)  set_grid(nx_in[n],  ny_in[n],  lon_in[n],  lat_in[n],  remap->grid_in+n);
+  for(n=0; n<ntiles_out; n++) set_grid(nx_out[n], ny_out[n], lon_out[n], lat_out[n], remap->grid_out+n);
+
+  remap->interp = (Interp_config *)calloc(ntiles_out, sizeof(Interp_config));
+  setup_conserve_interp(ntiles_in, remap->grid_in, ntiles_out, remap->grid_out, remap->interp, remap->opcode);
+
+  memset(&(remap->var), 0, sizeof(Var_config));
+  strcpy(remap->var.name, "libfregrid");
+  remap->var.interp_method = CONSERVE_ORDER1;
+  remap->var.cell_methods  = CELL_METHODS_MEAN;
+  remap->var.has_missing   = 1;
+  remap->var.nz            = 1;
+
+  remap->field_in  = (Field_config *)calloc(ntiles_in,  sizeof(Field_config));
+  remap->v_in      = (Field_config *)calloc(ntiles_in,  sizeof(Field_config));
+  remap->field_out = (Field_config *)calloc(ntiles_out, sizeof(Field_config));
+  remap->v_out     = (Field_config *)calloc(ntiles_out, sizeof(Field_config));
+  for(n=0; n<ntiles_in; n++) {
+    remap->field_in[n].var = &(remap->var);
+    remap->v_in[n].var     = &(remap->var);
+  }
+  for(n=0; n<ntiles_out; n++) {
+    remap->field_out[n].var = &(remap->var);
+    remap->v_out[n].var     = &(remap->var);
+  }
+
+  return remap;
+
+}; /* fregrid_create_remap */
+
+/*******************************************************************************
+  void fregrid_remap_scalar( )
+  remap nz levels of a scalar field from data_in (one buffer per input tile)
+  to data_out (one buffer per output tile).
+*******************************************************************************/
+void fregrid_remap_scalar(Fregrid_remap *remap, int nz, double missing,
+			  const double * const *data_in, double * const *data_out)
+{
+  int k, n;
+
+  remap->var.missing = missing;
+  for(k=0; k<nz; k++) {
+    for(n=0; n<remap->ntiles_in; n++)
+      remap->field_in[n].data = (double *)data_in[n] + (size_t)k*remap->grid_in[n].nx*remap->grid_in[n].ny;
+    for(n=0; n<remap->ntiles_out; n++)
+      remap->field_out[n].data = data_out[n] + (size_t)k*remap->grid_out[n].nxc*remap->grid_out[n].nyc;
+    do_scalar_conserve_interp(remap->interp, 0, remap->ntiles_in, remap->grid_in, remap->ntiles_out,
+			      remap->grid_out, remap->field_in, remap->field_out, remap->opcode, 1, NULL);
+  }
+
+}; /* fregrid_remap_scalar */
+
+/*******************************************************************************
+  void fregrid_remap_vector( )
+  remap one level of a vector field. u and v are the eastward and northward
+  components on both grids, no rotation is applied.
+*******************************************************************************/
+void fregrid_remap_vector(Fregrid_remap *remap, double missing,
+			  const double * const *u_in, const double * const *v_in,
+			  double * const *u_out, double * const *v_out)
+{
+  int n;
+
+  remap->var.missing = missing;
+  for(n=0; n<remap->ntiles_in; n++) {
+    remap->field_in[n].data = (double *)u_in[n];
+    remap->v_in[n].data     = (double *)v_in[n];
+  }
+  for(n=0; n<remap->ntiles_out; n++) {
+    remap->field_out[n].data = u_out[n];
+    remap->v_out[n].data     = v_out[n];
+  }
+  do_vector_conserve_interp(remap->interp, 0, remap->ntiles_in, remap->grid_in, remap->ntiles_out,
+			    remap->grid_out, remap->field_in, remap->v_in, remap->field_out,
+			    remap->v_out, remap->opcode);
+
+}; /* fregrid_remap_vector */
+
+/*******************************************************************************
+  long fregrid_remap_nxgrid(const Fregrid_remap *remap)
+  return the number of exchange grid cells of the handle.
+*******************************************************************************/
+long fregrid_remap_nxgrid(const Fregrid_remap *remap)
+{
+  long nxgrid;
+  int  n;
+
+  nxgrid = 0;
+  for(n=0; n<remap->ntiles_out; n++) nxgrid += remap->interp[n].nxgrid;
+  return nxgrid;
+
+}; /* fregrid_remap_nxgrid */
+
+/*******************************************************************************
+  void fregrid_free_remap(Fregrid_remap *remap)
+  release the memory of the handle. The caller buffers are not touched.
+*******************************************************************************/
+void fregrid_free_remap(Fregrid_remap *remap)
+{
+  int n;
+
+  if(!remap) return;
+  for(n=0; n<remap->ntiles_out; n++) {
+    free(remap->interp[n].i_in);
+    free(remap->interp[n].j_in);
+    free(remap->interp[n].i_out);
+    free(remap->interp[n].j_out);
+    free(remap->interp[n].t_in);
+    free(remap->interp[n].area);
+    free(remap->grid_out[n].lonc);
+    free(remap->grid_out[n].latc);
+  }
+  for(n=0; n<remap->ntiles_in; n++) {
+    free(remap->grid_in[n].lonc);
+    free(remap->grid_in[n].latc);
+  }
+  free(remap->interp);
+  free(remap->grid_in);
+  free(remap->grid_out);
+  free(remap->field_in);
+  free(remap->field_out);
+  free(remap->v_in);
+  free(remap->v_out);
+  free(remap);
+
+}; /* fregrid_free_remap */
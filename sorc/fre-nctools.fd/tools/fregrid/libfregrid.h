@@ -0,0 +1,35 @@
+/** @file
+    @brief In-memory conservative remapping with the fregrid interpolation
+    routines.
+
+    A remap handle is created once from the cell corner coordinates of the
+    source and destination mosaics, then applied to any number of fields held
+    in caller-owned buffers, and freed. No file is read or written.
+
+    Coordinates are the (nx+1)*(ny+1) cell corners of each tile in degrees,
+    with i varying fastest. Fields are nx*ny per tile and level, levels
+    contiguous. Source cells equal to missing are skipped, and destination
+    cells not covered by any valid source cell are set to missing.
+
+    Only first order conservative remapping is available through the handle.
+    The handle works on the calling process only, it does not use MPI.
+*/
+#ifndef LIBFREGRID_H_
+#define LIBFREGRID_H_
+
+typedef struct Fregrid_remap Fregrid_remap;
+
+Fregrid_remap *fregrid_create_remap(int ntiles_in, const int *nx_in, const int *ny_in,
+				    const double * const *lon_in, const double * const *lat_in,
+				    int ntiles_out, const int *nx_out, const int *ny_out,
+				    const double * const *lon_out, const double * const *lat_out,
+				    int great_circle);
+void fregrid_remap_scalar(Fregrid_remap *remap, int nz, double missing,
+			  const double * const *data_in, double * const *data_out);
+void fregrid_remap_vector(Fregrid_remap *remap, double missing,
+			  const double * const *u_in, const double * const *v_in,
+			  double * const *u_out, double * const *v_out);
+long fregrid_remap_nxgrid(const Fregrid_remap *remap);
+void fregrid_free_remap(Fregrid_remap *remap);
+
+#endif
@@ -0,0 +1,148 @@
+/* The following is a test program to test the service mode of fregrid
+   (--job_file). Two jobs write the same output file, so the second job
+   has to create again the file of the first job, and a job with a missing
+   input file is skipped. The path of the fregrid executable is the first
+   argument. */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "constant.h"
+#include "mpp.h"
+#include "mpp_io.h"
+
+#define NX 8
+#define NY 4
+
+/* supergrid of a global regular lat-lon grid with NX by NY cells */
+static void write_grid(const char *grid_file, const char *mosaic_file)
+{
+    double x[(2*NY+1)*(2*NX+1)], y[(2*NY+1)*(2*NX+1)];
+    char name[STRING];
+    int fid, dims[2], vid_x, vid_y, vid_f, vid_t;
+    int i, j;
+
+    for (j = 0; j <= 2*NY; j++)
+        for (i = 0; i <= 2*NX; i++) {
+            x[j*(2*NX+1)+i] = 360.0*i/(2*NX);
+            y[j*(2*NX+1)+i] = -90.0 + 180.0*j/(2*NY);
+        }
+    fid = mpp_open(grid_file, MPP_WRITE);
+    mpp_def_dim(fid, "nx", 2*NX);
+    mpp_def_dim(fid, "ny", 2*NY);
+    dims[1] = mpp_def_dim(fid, "nxp", 2*NX+1);
+    dims[0] = mpp_def_dim(fid, "nyp", 2*NY+1);
+    vid_x = mpp_def_var(fid, "x", MPP_DOUBLE, 2, dims, 0);
+    vid_y = mpp_def_var(fid, "y", MPP_DOUBLE, 2, dims, 0);
+    mpp_end_def(fid);
+    mpp_put_var_value(fid, vid_x, x);
+    mpp_put_var_value(fid, vid_y, y);
+    mpp_close(fid);
+
+    fid = mpp_open(mosaic_file, MPP_WRITE);
+    dims[0] = mpp_def_dim(fid, "ntiles", 1);
+    dims[1] = mpp_def_dim(fid, "string", STRING);
+    vid_f = mpp_def_var(fid, "gridfiles", MPP_CHAR, 2, dims, 0);
+    vid_t = mpp_def_var(fid, "gridtiles", MPP_CHAR, 2, dims, 0);
+    mpp_end_def(fid);
+    memset(name, 0, STRING);
+    strcpy(name, grid_file);
+    mpp_put_var_value(fid, vid_f, name);
+    memset(name, 0, STRING);
+    strcpy(name, "tile1");
+    mpp_put_var_value(fid, vid_t, name);
+    mpp_close(fid);
+}
+
+/* a constant field temp on the cell centers of the grid */
+static void write_data(const char *file, double value)
+{
+    double lon[NX], lat[NY], temp[NY*NX];
+    int fid, dims[2], vid_lon, vid_lat, vid_temp;
+    int i;
+
+    for (i = 0; i < NX; i++) lon[i] = 360.0*(i+0.5)/NX;
+    for (i = 0; i < NY; i++) lat[i] = -90.0 + 180.0*(i+0.5)/NY;
+    for (i = 0; i < NX*NY; i++) temp[i] = value;
+    fid = mpp_open(file, MPP_WRITE);
+    dims[1] = mpp_def_dim(fid, "lon", NX);
+    dims[0] = mpp_def_dim(fid, "lat", NY);
+    vid_lon = mpp_def_var(fid, "lon", MPP_DOUBLE, 1, dims+1, 1, "cartesian_axis", "X");
+    vid_lat = mpp_def_var(fid, "lat", MPP_DOUBLE, 1, dims, 1, "cartesian_axis", "Y");
+    vid_temp = mpp_def_var(fid, "temp", MPP_DOUBLE, 2, dims, 0);
+    mpp_end_def(fid);
+    mpp_put_var_value(fid, vid_lon, lon);
+    mpp_put_var_value(fid, vid_lat, lat);
+    mpp_put_var_value(fid, vid_temp, temp);
+    mpp_close(fid);
+}
+
+/* return 0 when the field temp of file is value everywhere */
+static int check_output(const char *file, int nx, int ny, double value)
+{
+    double *temp;
+    int fid, vid, i, err = 0;
+
+    fid = mpp_open(file, MPP_READ);
+    if (mpp_get_dimlen(fid, "lon") != nx || mpp_get_dimlen(fid, "lat") != ny) {
+        printf("%s has the wrong size\n", file);
+        return 1;
+    }
+    temp = malloc(nx*ny*sizeof(double));
+    vid = mpp_get_varid(fid, "temp");
+    mpp_get_var_value(fid, vid, temp);
+    for (i = 0; i < nx*ny; i++)
+        if (fabs(temp[i] - value) > 1.e-10) {
+            printf("temp of %s is %g at %d, expected %g\n", file, temp[i], i, value);
+            err = 1;
+            break;
+        }
+    free(temp);
+    mpp_close(fid);
+    return err;
+}
+
+int main(int argc, char* argv[])
+{
+    char cmd[1024];
+    FILE *fp;
+
+    printf("Testing the job_file option of fregrid.\n");
+    if (argc < 2) {
+        printf("usage: tst_fregrid_job fregrid_executable\n");
+        return 1;
+    }
+
+    mpp_init(&argc, &argv);
+    write_grid("job_grid.nc", "job_mosaic.nc");
+    write_data("job_in1.nc", 1.5);
+    write_data("job_in2.nc", 2.5);
+    remove("job_missing.nc");
+    remove("job_out.nc");
+    remove("job_out2.nc");
+
+    /* the first two jobs write job_out.nc, the third one has no input file */
+    fp = fopen("job_list.txt", "w");
+    fprintf(fp, "# jobs of tst_fregrid_job\n");
+    fprintf(fp, "job_in1.nc job_out.nc temp\n");
+    fprintf(fp, "job_in2.nc job_out.nc temp\n");
+    fprintf(fp, "job_missing.nc job_out2.nc temp\n");
+    fprintf(fp, "job_in1.nc job_out2.nc temp\n");
+    fclose(fp);
+
+    sprintf(cmd, "%s --input_mosaic job_mosaic.nc --nlon 12 --nlat 6 "
+            "--interp_method conserve_order1 --job_file job_list.txt", argv[1]);
+    if (system(cmd) != 0) {
+        printf("fregrid failed: %s\n", cmd);
+        return 1;
+    }
+
+    /* job_out.nc holds the field of the second job */
+    if (check_output("job_out.nc", 12, 6, 2.5)) return 1;
+    if (check_output("job_out2.nc", 12, 6, 1.5)) return 1;
+
+    mpp_end();
+    printf("SUCCESS!\n");
+    return 0;
+}
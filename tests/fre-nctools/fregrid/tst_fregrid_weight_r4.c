@@ -0,0 +1,154 @@
+/* The following is a test program to test the --weight_r4 option of
+   fregrid. A smooth field on a lat-lon grid is remapped with first order
+   conservative interpolation, once with double and once with single
+   precision exchange grid weights, and the two results must agree to
+   single precision. The path of the fregrid executable is the first
+   argument. */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "constant.h"
+#include "mpp.h"
+#include "mpp_io.h"
+
+#define D2R (M_PI/180)
+#define NX 36
+#define NY 18
+#define NX_OUT 20
+#define NY_OUT 10
+
+/* supergrid of a global regular lat-lon grid with NX by NY cells */
+static void write_grid(const char *grid_file, const char *mosaic_file)
+{
+    static double x[(2*NY+1)*(2*NX+1)], y[(2*NY+1)*(2*NX+1)];
+    char name[STRING];
+    int fid, dims[2], vid_x, vid_y, vid_f, vid_t;
+    int i, j;
+
+    for (j = 0; j <= 2*NY; j++)
+        for (i = 0; i <= 2*NX; i++) {
+            x[j*(2*NX+1)+i] = 360.0*i/(2*NX);
+            y[j*(2*NX+1)+i] = -90.0 + 180.0*j/(2*NY);
+        }
+    fid = mpp_open(grid_file, MPP_WRITE);
+    mpp_def_dim(fid, "nx", 2*NX);
+    mpp_def_dim(fid, "ny", 2*NY);
+    dims[1] = mpp_def_dim(fid, "nxp", 2*NX+1);
+    dims[0] = mpp_def_dim(fid, "nyp", 2*NY+1);
+    vid_x = mpp_def_var(fid, "x", MPP_DOUBLE, 2, dims, 0);
+    vid_y = mpp_def_var(fid, "y", MPP_DOUBLE, 2, dims, 0);
+    mpp_end_def(fid);
+    mpp_put_var_value(fid, vid_x, x);
+    mpp_put_var_value(fid, vid_y, y);
+    mpp_close(fid);
+
+    fid = mpp_open(mosaic_file, MPP_WRITE);
+    dims[0] = mpp_def_dim(fid, "ntiles", 1);
+    dims[1] = mpp_def_dim(fid, "string", STRING);
+    vid_f = mpp_def_var(fid, "gridfiles", MPP_CHAR, 2, dims, 0);
+    vid_t = mpp_def_var(fid, "gridtiles", MPP_CHAR, 2, dims, 0);
+    mpp_end_def(fid);
+    memset(name, 0, STRING);
+    strcpy(name, grid_file);
+    mpp_put_var_value(fid, vid_f, name);
+    memset(name, 0, STRING);
+    strcpy(name, "tile1");
+    mpp_put_var_value(fid, vid_t, name);
+    mpp_close(fid);
+}
+
+/* a field temp varying in latitude and longitude on the cell centers */
+static void write_data(const char *file)
+{
+    double lon[NX], lat[NY], temp[NY*NX];
+    int fid, dims[2], vid_lon, vid_lat, vid_temp;
+    int i, j;
+
+    for (i = 0; i < NX; i++) lon[i] = 360.0*(i+0.5)/NX;
+    for (j = 0; j < NY; j++) lat[j] = -90.0 + 180.0*(j+0.5)/NY;
+    for (j = 0; j < NY; j++)
+        for (i = 0; i < NX; i++)
+            temp[j*NX+i] = 280.0 + 20.0*cos(D2R*lat[j])*cos(2*D2R*lon[i]);
+    fid = mpp_open(file, MPP_WRITE);
+    dims[1] = mpp_def_dim(fid, "lon", NX);
+    dims[0] = mpp_def_dim(fid, "lat", NY);
+    vid_lon = mpp_def_var(fid, "lon", MPP_DOUBLE, 1, dims+1, 1, "cartesian_axis", "X");
+    vid_lat = mpp_def_var(fid, "lat", MPP_DOUBLE, 1, dims, 1, "cartesian_axis", "Y");
+    vid_temp = mpp_def_var(fid, "temp", MPP_DOUBLE, 2, dims, 0);
+    mpp_end_def(fid);
+    mpp_put_var_value(fid, vid_lon, lon);
+    mpp_put_var_value(fid, vid_lat, lat);
+    mpp_put_var_value(fid, vid_temp, temp);
+    mpp_close(fid);
+}
+
+static void read_output(const char *file, double *temp)
+{
+    int fid, vid;
+
+    fid = mpp_open(file, MPP_READ);
+    vid = mpp_get_varid(fid, "temp");
+    mpp_get_var_value(fid, vid, temp);
+    mpp_close(fid);
+}
+
+/* remap temp of r4_in.nc to output_file, return the exit status of fregrid */
+static int run_fregrid(const char *fregrid, const char *interp_method, const char *output_file,
+                       const char *options)
+{
+    char cmd[1024];
+
+    sprintf(cmd, "%s --input_mosaic r4_mosaic.nc --nlon %d --nlat %d --interp_method %s "
+            "--input_file r4_in.nc --scalar_field temp --output_file %s %s",
+            fregrid, NX_OUT, NY_OUT, interp_method, output_file, options);
+    if (system(cmd) != 0) {
+        printf("fregrid failed: %s\n", cmd);
+        return 1;
+    }
+    return 0;
+}
+
+/* remap with the double and the single precision weights and compare */
+static int compare_r4_r8(const char *fregrid, const char *interp_method)
+{
+    double temp_r8[NY_OUT*NX_OUT], temp_r4[NY_OUT*NX_OUT], diff, maxdiff = 0;
+    int i;
+
+    if (run_fregrid(fregrid, interp_method, "r4_out_r8.nc", "")) return 1;
+    if (run_fregrid(fregrid, interp_method, "r4_out_r4.nc", "--weight_r4")) return 1;
+
+    read_output("r4_out_r8.nc", temp_r8);
+    read_output("r4_out_r4.nc", temp_r4);
+    for (i = 0; i < NX_OUT*NY_OUT; i++) {
+        diff = fabs(temp_r4[i] - temp_r8[i])/fabs(temp_r8[i]);
+        if (diff > maxdiff) maxdiff = diff;
+    }
+    printf("%s: largest relative difference of the single precision weights is %g\n",
+           interp_method, maxdiff);
+    if (maxdiff > 1.e-5) {
+        printf("the single precision weights are not accurate enough\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    printf("Testing the weight_r4 option of fregrid.\n");
+    if (argc < 2) {
+        printf("usage: tst_fregrid_weight_r4 fregrid_executable\n");
+        return 1;
+    }
+
+    mpp_init(&argc, &argv);
+    write_grid("r4_grid.nc", "r4_mosaic.nc");
+    write_data("r4_in.nc");
+
+    if (compare_r4_r8(argv[1], "conserve_order1")) return 1;
+
+    mpp_end();
+    printf("SUCCESS!\n");
+    return 0;
+}
@@ -0,0 +1,105 @@
+/* The following is a test program to test the in-memory remapping
+   API in libfregrid.c. */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libfregrid.h"
+
+#define D2R (M_PI/180)
+#define MISSING (-999.0)
+
+/* cell corners of a global regular lat-lon grid, in degrees */
+static void lonlat_corners(int nx, int ny, double *lon, double *lat)
+{
+    int i, j;
+
+    for (j = 0; j <= ny; j++)
+        for (i = 0; i <= nx; i++) {
+            lon[j*(nx+1)+i] = 360.0*i/nx;
+            lat[j*(nx+1)+i] = -90.0 + 180.0*j/ny;
+        }
+}
+
+/* area of the cells of a regular lat-lon grid on the unit sphere */
+static double cell_area(int nx, int ny, int j)
+{
+    return 2*M_PI/nx*(sin(D2R*(-90.0 + 180.0*(j+1)/ny)) - sin(D2R*(-90.0 + 180.0*j/ny)));
+}
+
+int main(int argc, char* argv[])
+{
+    int nx_in = 90, ny_in = 45, nx_out = 60, ny_out = 36, nz = 2;
+    double *lon_in, *lat_in, *lon_out, *lat_out, *data_in, *data_out;
+    double sum_in, sum_out;
+    Fregrid_remap *remap;
+    int i, j, k;
+
+    printf("Testing libfregrid.\n");
+
+    lon_in  = malloc((nx_in+1)*(ny_in+1)*sizeof(double));
+    lat_in  = malloc((nx_in+1)*(ny_in+1)*sizeof(double));
+    lon_out = malloc((nx_out+1)*(ny_out+1)*sizeof(double));
+    lat_out = malloc((nx_out+1)*(ny_out+1)*sizeof(double));
+    data_in  = malloc(nx_in*ny_in*nz*sizeof(double));
+    data_out = malloc(nx_out*ny_out*nz*sizeof(double));
+    lonlat_corners(nx_in, ny_in, lon_in, lat_in);
+    lonlat_corners(nx_out, ny_out, lon_out, lat_out);
+
+    remap = fregrid_create_remap(1, &nx_in, &ny_in, (const double * const *)&lon_in,
+                                 (const double * const *)&lat_in, 1, &nx_out, &ny_out,
+                                 (const double * const *)&lon_out, (const double * const *)&lat_out, 0);
+    if (fregrid_remap_nxgrid(remap) <= 0) {
+        printf("no exchange grid cell\n");
+        return 1;
+    }
+
+    /* level 0 is constant, level 1 varies in latitude and longitude */
+    for (j = 0; j < ny_in; j++)
+        for (i = 0; i < nx_in; i++) {
+            data_in[j*nx_in+i] = 3.5;
+            data_in[nx_in*ny_in+j*nx_in+i] = 2.0 + sin(D2R*(4.0*j-88.0))*cos(D2R*4.0*i);
+        }
+    fregrid_remap_scalar(remap, nz, MISSING, (const double * const *)&data_in, &data_out);
+
+    for (i = 0; i < nx_out*ny_out; i++)
+        if (fabs(data_out[i] - 3.5) > 1.e-10) {
+            printf("constant field is not preserved at %d: %g\n", i, data_out[i]);
+            return 1;
+        }
+
+    /* the area weighted sum is conserved */
+    for (k = 1; k < nz; k++) {
+        sum_in = sum_out = 0;
+        for (j = 0; j < ny_in; j++)
+            for (i = 0; i < nx_in; i++)
+                sum_in += data_in[k*nx_in*ny_in+j*nx_in+i]*cell_area(nx_in, ny_in, j);
+        for (j = 0; j < ny_out; j++)
+            for (i = 0; i < nx_out; i++)
+                sum_out += data_out[k*nx_out*ny_out+j*nx_out+i]*cell_area(nx_out, ny_out, j);
+        if (fabs(sum_out - sum_in) > 1.e-8*fabs(sum_in)) {
+            printf("level %d is not conserved: %g %g\n", k, sum_in, sum_out);
+            return 1;
+        }
+    }
+
+    /* destination cells with no valid source are missing */
+    for (i = 0; i < nx_in*ny_in; i++) data_in[i] = MISSING;
+    fregrid_remap_scalar(remap, 1, MISSING, (const double * const *)&data_in, &data_out);
+    for (i = 0; i < nx_out*ny_out; i++)
+        if (data_out[i] != MISSING) {
+            printf("cell %d should be missing: %g\n", i, data_out[i]);
+            return 1;
+        }
+
+    fregrid_free_remap(remap);
+    free(lon_in);
+    free(lat_in);
+    free(lon_out);
+    free(lat_out);
+    free(data_in);
+    free(data_out);
+
+    printf("SUCCESS!\n");
+    return 0;
+}
@@ -0,0 +1,113 @@
+/* This is a test program to test create_xgrid_2dx2d_order1_stream in
+   create_xgrid.c against create_xgrid_2dx2d_order1. */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "create_xgrid.h"
+
+#define D2R (M_PI/180)
+#define NX1 24
+#define NY1 18
+#define NX2 17
+#define NY2 23
+
+/* the exchange grid collected by the sink */
+typedef struct {
+    int    nxgrid;
+    int    *i_in, *j_in, *i_out, *j_out;
+    double *area;
+} Xgrid;
+
+static void collect(int nxgrid, const int *i_in, const int *j_in, const int *i_out, const int *j_out,
+                    const double *xgrid_area, void *sink_data)
+{
+    Xgrid *x = (Xgrid *)sink_data;
+    int n;
+
+    for(n=0; n<nxgrid; n++) {
+        x->i_in[x->nxgrid]  = i_in[n];
+        x->j_in[x->nxgrid]  = j_in[n];
+        x->i_out[x->nxgrid] = i_out[n];
+        x->j_out[x->nxgrid] = j_out[n];
+        x->area[x->nxgrid]  = xgrid_area[n];
+        x->nxgrid++;
+    }
+}
+
+/* look up the area of one exchange grid cell, -1 when it is not there */
+static double find_area(const Xgrid *x, int i1, int j1, int i2, int j2)
+{
+    int n;
+
+    for(n=0; n<x->nxgrid; n++)
+        if(x->i_in[n] == i1 && x->j_in[n] == j1 && x->i_out[n] == i2 && x->j_out[n] == j2)
+            return x->area[n];
+    return -1;
+}
+
+static void alloc_xgrid(Xgrid *x, int size)
+{
+    x->nxgrid = 0;
+    x->i_in  = (int *)malloc(size*sizeof(int));
+    x->j_in  = (int *)malloc(size*sizeof(int));
+    x->i_out = (int *)malloc(size*sizeof(int));
+    x->j_out = (int *)malloc(size*sizeof(int));
+    x->area  = (double *)malloc(size*sizeof(double));
+}
+
+int main(int argc, char* argv[])
+{
+    double lon_in[(NX1+1)*(NY1+1)], lat_in[(NX1+1)*(NY1+1)];
+    double lon_out[(NX2+1)*(NY2+1)], lat_out[(NX2+1)*(NY2+1)];
+    double mask_in[NX1*NY1];
+    int    nx1 = NX1, ny1 = NY1, nx2 = NX2, ny2 = NY2;
+    int    i, j, n, nblk;
+    int    nrow_block[4] = {1, 4, 7, 0};
+    Xgrid  whole, stream;
+    long   nxgrid;
+
+    printf("Testing create_xgrid_2dx2d_order1_stream.\n");
+
+    /* a regular input grid and a distorted output grid over the same region */
+    for(j=0; j<=NY1; j++) for(i=0; i<=NX1; i++) {
+        lon_in[j*(NX1+1)+i] = (100.0 + 60.0*i/NX1)*D2R;
+        lat_in[j*(NX1+1)+i] = (-30.0 + 50.0*j/NY1)*D2R;
+    }
+    for(j=0; j<=NY2; j++) for(i=0; i<=NX2; i++) {
+        lon_out[j*(NX2+1)+i] = (102.0 + 55.0*i/NX2 + 1.5*sin(0.7*j))*D2R;
+        lat_out[j*(NX2+1)+i] = (-28.0 + 46.0*j/NY2 + 1.0*cos(0.5*i))*D2R;
+    }
+    for(n=0; n<NX1*NY1; n++) mask_in[n] = (n%11 == 3) ? 0.0 : 1.0;
+
+    alloc_xgrid(&whole, (int)MAXXGRID);
+    alloc_xgrid(&stream, (int)MAXXGRID);
+    whole.nxgrid = create_xgrid_2dx2d_order1(&nx1, &ny1, &nx2, &ny2, lon_in, lat_in, lon_out, lat_out, mask_in,
+                                             whole.i_in, whole.j_in, whole.i_out, whole.j_out, whole.area);
+    if(whole.nxgrid == 0) {
+        printf("FAILED! no exchange grid cell is found\n");
+        return 1;
+    }
+
+    for(nblk=0; nblk<4; nblk++) {
+        stream.nxgrid = 0;
+        nxgrid = create_xgrid_2dx2d_order1_stream(&nx1, &ny1, &nx2, &ny2, lon_in, lat_in, lon_out, lat_out, mask_in,
+                                                  nrow_block[nblk], collect, &stream);
+        if(nxgrid != stream.nxgrid || nxgrid != whole.nxgrid) {
+            printf("FAILED! nrow_block = %d: nxgrid is %ld, the sink got %d, expected %d\n",
+                   nrow_block[nblk], nxgrid, stream.nxgrid, whole.nxgrid);
+            return 1;
+        }
+        /* same cells with bitwise the same area, in any order */
+        for(n=0; n<whole.nxgrid; n++) {
+            if(find_area(&stream, whole.i_in[n], whole.j_in[n], whole.i_out[n], whole.j_out[n]) != whole.area[n]) {
+                printf("FAILED! nrow_block = %d: exchange grid cell %d does not match\n", nrow_block[nblk], n);
+                return 1;
+            }
+        }
+    }
+
+    printf("SUCCESS!\n");
+    return 0;
+}
@@ -0,0 +1,77 @@
+/* The following is a test program to test the multi-level gradient
+   kernel grad_c2l_nz in gradient_c2l.c against grad_c2l. */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "gradient_c2l.h"
+
+#define NX 37
+#define NY 23
+#define NZ 5
+
+/* pseudo random value in [0.1, 1.1) */
+static double rand_val(void)
+{
+    return rand()/(double)RAND_MAX + 0.1;
+}
+
+int main(int argc, char* argv[])
+{
+    double pin[(NX+2)*(NY+2)*NZ];
+    double dx[NX*(NY+1)], dy[(NX+1)*NY], area[NX*NY];
+    double edge_w[NY+1], edge_e[NY+1], edge_s[NX+1], edge_n[NX+1];
+    double en_n[3*NX*(NY+1)], en_e[3*(NX+1)*NY];
+    double vlon[3*NX*NY], vlat[3*NX*NY];
+    double grad_x[NX*NY*NZ], grad_y[NX*NY*NZ], grad_x1[NX*NY], grad_y1[NX*NY];
+    double wgt[8*NX*NY];
+    double diff, gmax;
+    int    nx = NX, ny = NY, is_true = 1;
+    int    i, k;
+
+    printf("Testing grad_c2l_nz.\n");
+
+    srand(3);
+    for(i=0; i<(NX+2)*(NY+2)*NZ; i++) pin[i] = rand_val();
+    for(i=0; i<NX*(NY+1); i++) dx[i] = rand_val();
+    for(i=0; i<(NX+1)*NY; i++) dy[i] = rand_val();
+    for(i=0; i<NX*NY; i++) area[i] = rand_val();
+    for(i=0; i<=NY; i++) {
+        edge_w[i] = rand_val();
+        edge_e[i] = rand_val();
+    }
+    for(i=0; i<=NX; i++) {
+        edge_s[i] = rand_val();
+        edge_n[i] = rand_val();
+    }
+    for(i=0; i<3*NX*(NY+1); i++) en_n[i] = rand_val() - 0.6;
+    for(i=0; i<3*(NX+1)*NY; i++) en_e[i] = rand_val() - 0.6;
+    for(i=0; i<3*NX*NY; i++) {
+        vlon[i] = rand_val() - 0.6;
+        vlat[i] = rand_val() - 0.6;
+    }
+
+    grad_c2l_weight(nx, ny, dx, dy, area, en_n, en_e, vlon, vlat, wgt);
+    grad_c2l_nz(nx, ny, NZ, pin, wgt, edge_w, edge_e, edge_s, edge_n, grad_x, grad_y, 1, 1, 1, 1);
+
+    /* every level must match the single level routine up to roundoff */
+    diff = 0;
+    gmax = 0;
+    for(k=0; k<NZ; k++) {
+        grad_c2l(&nx, &ny, pin+k*(NX+2)*(NY+2), dx, dy, area, edge_w, edge_e, edge_s, edge_n,
+                 en_n, en_e, vlon, vlat, grad_x1, grad_y1, &is_true, &is_true, &is_true, &is_true);
+        for(i=0; i<NX*NY; i++) {
+            diff = fmax(diff, fabs(grad_x[k*NX*NY+i] - grad_x1[i]));
+            diff = fmax(diff, fabs(grad_y[k*NX*NY+i] - grad_y1[i]));
+            gmax = fmax(gmax, fmax(fabs(grad_x1[i]), fabs(grad_y1[i])));
+        }
+    }
+    printf("max difference = %g, max gradient = %g\n", diff, gmax);
+    if(diff > 1.e-12*gmax) {
+        printf("FAILED!\n");
+        return 1;
+    }
+
+    printf("SUCCESS!\n");
+    return 0;
+}
@@ -0,0 +1,59 @@
+/* The following is a test program to test the reproducible sum in
+   mpp_efp.c: the result must not depend on the order of the terms or on
+   how they are split into partial sums. */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mpp_efp.h"
+
+#define N 200000
+
+/* pseudo random value of mixed sign and magnitude */
+static double rand_val(void)
+{
+    double x = rand()/(double)RAND_MAX - 0.5;
+    return ldexp(x, rand()%80 - 40);
+}
+
+int main(int argc, char* argv[])
+{
+    static double x[N];
+    efp_type sum1, sum2, part[7];
+    double   r1, r2, r3, cancel;
+    int      i, j;
+
+    printf("Testing reproducible sum of mpp_efp.\n");
+
+    srand(5);
+    for(i=0; i<N; i++) x[i] = rand_val();
+
+    /* forward and backward order */
+    efp_clear(&sum1);
+    for(i=0; i<N; i++) efp_add(&sum1, x[i]);
+    efp_clear(&sum2);
+    for(i=N-1; i>=0; i--) efp_add(&sum2, x[i]);
+    r1 = efp_to_double(&sum1);
+    r2 = efp_to_double(&sum2);
+
+    /* strided partial sums merged together, as done by an OpenMP reduction */
+    for(j=0; j<7; j++) efp_clear(part+j);
+    for(i=0; i<N; i++) efp_add(part+(i*31)%7, x[i]);
+    for(j=1; j<7; j++) efp_merge(part, part+j);
+    mpp_sum_efp(part);
+    r3 = efp_to_double(part);
+
+    /* adding the negated terms in another order cancels exactly */
+    for(i=0; i<N; i+=2) efp_add(&sum1, -x[i]);
+    for(i=1; i<N; i+=2) efp_add(&sum1, -x[i]);
+    cancel = efp_to_double(&sum1);
+
+    printf("sum = %.17g %.17g %.17g, after cancellation = %g\n", r1, r2, r3, cancel);
+    if(r1 != r2 || r1 != r3 || cancel != 0) {
+        printf("FAILED!\n");
+        return 1;
+    }
+
+    printf("SUCCESS!\n");
+    return 0;
+}